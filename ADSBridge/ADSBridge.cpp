@@ -2,467 +2,190 @@
 //
 #include "ADSBridge.h"
 
-
-typedef enum AdsDataType
-{
-	ADST_VOID = 0,
-	ADST_INT16 = 2,
-	ADST_INT32 = 3,
-	ADST_REAL32 = 4,
-	ADST_REAL64 = 5,
-	ADST_INT8 = 16,
-	ADST_UINT8 = 17,
-	ADST_UINT16 = 18,
-	ADST_UINT32 = 19,
-	ADST_INT64 = 20,
-	ADST_UINT64 = 21,
-	ADST_STRING = 30,
-	ADST_WSTRING = 31,
-	ADST_REAL80 = 32,
-	ADST_BIT = 33,
-	ADST_MAXTYPES = 34,
-	ADST_BIGTYPE = 65
-} ADSDATATYPE;
-
-// Splits string by slash (path separator)
-std::vector<std::string> splitPath(std::string path) {
-	std::vector<std::string> paths{};
-	for (size_t pos = 0; (pos = path.find("/")) != std::string::npos; (pos = path.find("/"))) {
-		paths.push_back(path.substr(0, pos));
-		path.erase(0, pos + 1);
-	}
-	paths.push_back(path);
-	return paths;
+// Encodings of request and response bodies, negotiated by Content-Type and Accept headers
+enum class BodyEncoding { Json, MsgPack, Cbor };
+
+// Returns encoding named in header value, JSON unless MessagePack or CBOR is named
+static BodyEncoding getBodyEncoding(const std::string& mediaType) {
+	if (mediaType.find("application/msgpack") != std::string::npos || mediaType.find("application/x-msgpack") != std::string::npos) return BodyEncoding::MsgPack;
+	if (mediaType.find("application/cbor") != std::string::npos) return BodyEncoding::Cbor;
+	return BodyEncoding::Json;
 }
 
-// Gets handle for symbol/variable with given name
-auto getSymHandleByName(PAmsAddr pAddr, std::string& varName) {
-	ULONG symHandle{};
-	long nErr = AdsSyncReadWriteReq(pAddr, ADSIGRP_SYM_HNDBYNAME, 0x0, sizeof(symHandle), &symHandle, static_cast<ULONG>(varName.length()), varName.data());
-	return std::make_pair(nErr, symHandle);
-}
-
-// Returns data at index group and offset depending on data type
-auto readGroupOffset(PAmsAddr pAddr, const ULONG& indexGroup, const ULONG& indexOffset, auto&& pData) {
-	auto data{ pData };
-	long nErr = AdsSyncReadReq(pAddr, indexGroup, indexOffset, sizeof(data), &data);
-	return std::pair(nErr, data);
-}
-
-// Returns data at index group and offset depending on data type and updates nErr parameter accordingly
-auto readGroupOffset(PAmsAddr pAddr, const ULONG& indexGroup, const ULONG& indexOffset, auto&& pData, long& nErr) {
-	auto [err, data] = readGroupOffset(pAddr, indexGroup, indexOffset, pData);
-	nErr = err;
-	return std::pair(nErr, data);
-}
-
-// Returns data at index group and offset depending on data type and updates nErr as well as str parameter accordingly
-auto readGroupOffset(PAmsAddr pAddr, const ULONG& indexGroup, const ULONG& indexOffset, auto&& pData, long& nErr, std::string& str) {
-	auto [err, data] = readGroupOffset(pAddr, indexGroup, indexOffset, pData, nErr);
-	std::stringstream dstream;
-	dstream << data;
-	str = dstream.str();
-	return std::pair(nErr, str);
-}
-
-// Writes given data at index group and offset
-auto writeGroupOffset(PAmsAddr pAddr, const ULONG& indexGroup, const ULONG& indexOffset, const auto& data) {
-	auto rData{ data };
-	long nErr = AdsSyncWriteReq(pAddr, indexGroup, indexOffset, sizeof(rData), &rData);
-	return nErr;
-}
-
-// Reads from handle
-auto getSymValueByHandle(PAmsAddr pAddr, const ULONG& symHandle, auto& nData) {
-	return readGroupOffset(ADSIGRP_SYM_VALBYHND, symHandle, nData);
-}
-
-struct TwinCatArray {
-	unsigned long   bound;
-	unsigned long   size;
-};
-
-struct TwinCatType {
-	std::string name;
-	std::string type;
-	std::string comment;
-	std::map<std::string, TwinCatType> subItems;
-	ADS_UINT32		entryLength;
-	ADS_UINT32		version;
-	ADS_UINT32		size;
-	ADS_UINT32		offs;
-	ADS_UINT32		dataType;
-	ADS_UINT32		flags;
-	ADS_UINT16		arrayDim;
-	std::vector<TwinCatArray>   arrayVector;
-};
-
-// Store symbol/variable declaration
-struct TwinCatVar {
-	std::string name;
-	ULONG indexGroup;
-	ULONG indexOffset;
-	ULONG size;
-	std::string type;
-	std::string comment;
-	TwinCatType datatype;
-	std::string str() const {
-		std::stringstream strstream;
-		strstream << "{\"Name\":\"" << name << "\",";
-		strstream << "\"IndexGroup\":" << indexGroup << ",";
-		strstream << "\"IndexOffset\":" << indexOffset << ",";
-		strstream << "\"Size\":" << size << ",";
-		strstream << "\"Type\":\"" << type << "\",";
-		strstream << "\"Comment\":\"" << comment << "\"}";
-		return strstream.str();
+// Sets response body, compressed with the content coding accepted by Accept-Encoding header if it is large enough
+static void setBody(const httplib::Request& req, httplib::Response& res, std::string body, const char* contentType) {
+	ContentEncoding encoding = body.size() >= COMPRESSION_THRESHOLD ? getContentEncoding(req.get_header_value("Accept-Encoding")) : ContentEncoding::Identity;
+	if (encoding != ContentEncoding::Identity) {
+		if (auto compressed = compressBody(body, encoding)) {
+			body = std::move(*compressed);
+			res.set_header("Content-Encoding", getContentEncodingName(encoding));
+		}
 	}
-};
-
-auto getUploadInfo(PAmsAddr pAddr) {
-	AdsSymbolUploadInfo2 tAdsSymbolUploadInfo;
-	long nErr = AdsSyncReadReq(pAddr, ADSIGRP_SYM_UPLOADINFO2, 0x0, sizeof(tAdsSymbolUploadInfo), &tAdsSymbolUploadInfo);
-	return std::make_pair(nErr, tAdsSymbolUploadInfo);
-}
-
-auto getSymbolUpload(PAmsAddr pAddr, AdsSymbolUploadInfo2 info) {
-	char* symbolUpload = new char[info.nSymSize];
-	long nErr = AdsSyncReadReq(pAddr, ADSIGRP_SYM_UPLOAD, 0, info.nSymSize, symbolUpload);
-	return std::make_pair(nErr, symbolUpload);
-}
-
-auto getDatatypeUpload(PAmsAddr pAddr, AdsSymbolUploadInfo2 info) {
-	char* dataUpload = new char[info.nDatatypeSize];
-	long nErr = AdsSyncReadReq(pAddr, ADSIGRP_SYM_DT_UPLOAD, 0, info.nDatatypeSize, dataUpload);
-	return std::make_pair(nErr, dataUpload);
+	res.set_header("Vary", "Accept, Accept-Encoding");
+	res.set_content(body, contentType);
 }
 
-bool isDatatype(PAdsDatatypeEntry datatype) {
-	if (datatype->flags == 0) return FALSE;
-	return (datatype->flags & ADSDATATYPEFLAG_DATATYPE) == ADSDATATYPEFLAG_DATATYPE;
-}
-
-bool isDataitem(PAdsDatatypeEntry datatype) {
-	if (datatype->flags == 0) return FALSE;
-	return (datatype->flags & ADSDATATYPEFLAG_DATAITEM) == ADSDATATYPEFLAG_DATAITEM;
-}
-
-TwinCatType getDatatype(PAdsDatatypeEntry datatypeEntry) {
-	std::string name{ PADSDATATYPENAME(datatypeEntry) };
-	std::string type{ PADSDATATYPETYPE(datatypeEntry) };
-	std::string comment{ PADSDATATYPECOMMENT(datatypeEntry) };
-	std::map<std::string, TwinCatType> subItems{};
-	for (UINT uiIndex = 0; uiIndex < datatypeEntry->subItems; uiIndex++)
+// Sets response body to JSON document in encoding requested by Accept header
+static void setContent(const httplib::Request& req, httplib::Response& res, const nlohmann::json& document) {
+	switch (getBodyEncoding(req.get_header_value("Accept"))) {
+	case BodyEncoding::MsgPack:
 	{
-		PAdsDatatypeEntry subEntry = AdsDatatypeStructItem(datatypeEntry, uiIndex);
-		subItems[PADSDATATYPENAME(subEntry)] = getDatatype(subEntry);
-	}
-	ADS_UINT32		entryLength = datatypeEntry->entryLength;
-	ADS_UINT32		version = datatypeEntry->version;
-	ADS_UINT32		size = datatypeEntry->size;
-	ADS_UINT32		offs = datatypeEntry->offs;
-	ADS_UINT32		dataType = datatypeEntry->dataType;
-	ADS_UINT32		flags = datatypeEntry->flags;
-	ADS_UINT16		arrayDim = datatypeEntry->arrayDim;
-	std::vector<TwinCatArray> arrayVector{};
-	PAdsDatatypeArrayInfo arrayInfo = PADSDATATYPEARRAYINFO(datatypeEntry);
-	for (UINT uiIndex = 0; uiIndex < arrayDim; uiIndex++) {
-		unsigned long bound = arrayInfo->lBound;
-		unsigned long size = arrayInfo->elements;
-		arrayVector.push_back(TwinCatArray{bound, size});
-		arrayInfo = (*((unsigned long*)(((char*)arrayInfo) + (sizeof(AdsDatatypeArrayInfo)))) \
-			? ((PAdsDatatypeArrayInfo)(((char*)arrayInfo) + (sizeof(AdsDatatypeArrayInfo)))) : NULL);
-	}
-	return TwinCatType{ name, type, comment, subItems, entryLength, version, size, offs, dataType, flags, arrayDim, arrayVector };
+		std::vector<std::uint8_t> data = nlohmann::json::to_msgpack(document);
+		setBody(req, res, std::string(data.begin(), data.end()), "application/msgpack");
+	}
+	break;
+	case BodyEncoding::Cbor:
+	{
+		std::vector<std::uint8_t> data = nlohmann::json::to_cbor(document);
+		setBody(req, res, std::string(data.begin(), data.end()), "application/cbor");
+	}
+	break;
+	default:
+		setBody(req, res, document.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace), "text/json");
+		break;
+	}
 }
 
-TwinCatType getDatatypeRecursive(std::map<std::string, TwinCatType> datatypes, std::string name, bool firstLevel = true) {
-	TwinCatType oldtype = datatypes[name];
-	TwinCatType newtype = TwinCatType{ oldtype.name, oldtype.type, oldtype.comment, {}, oldtype.entryLength, oldtype.version, oldtype.size, oldtype.offs, oldtype.dataType, 0, oldtype.arrayDim, {} };
-	if (oldtype.subItems.size() > 0) {
-		for (const auto& [key, value] : oldtype.subItems) {
-			TwinCatType subtype = getDatatypeRecursive(datatypes, value.type, false);
-			subtype.type = subtype.name;
-			subtype.name = key;
-			subtype.offs = value.offs;
-			subtype.comment = value.comment;
-			newtype.subItems[key] = subtype;
-		}
-	}
-	else if ((oldtype.type == "" || oldtype.dataType < ADST_MAXTYPES) && oldtype.arrayVector.size() == 0) {
-	} else if (oldtype.dataType == ADST_BIGTYPE && oldtype.arrayVector.size() == 0) {
-		if (oldtype.size == 4) {
-			newtype.dataType = ADST_UINT32;
-		}
-		else if (oldtype.size == 8) {
-			newtype.dataType = ADST_UINT64;
-		}
-	} else if (oldtype.arrayVector.size() > 0) {
-		newtype = getDatatypeRecursive(datatypes, oldtype.type, false);
-		std::vector<TwinCatArray> vec = oldtype.arrayVector;
-		vec.insert(vec.end(), newtype.arrayVector.begin(), newtype.arrayVector.end());
-		newtype.arrayVector = vec;
+// Sets response body to JSON text, converted to binary encoding if requested by Accept header
+static void setContent(const httplib::Request& req, httplib::Response& res, const std::string& json) {
+	if (getBodyEncoding(req.get_header_value("Accept")) == BodyEncoding::Json) {
+		setBody(req, res, json, "text/json");
 	}
 	else {
-		newtype = getDatatypeRecursive(datatypes, oldtype.type, false);
+		setContent(req, res, nlohmann::json::parse(json));
 	}
-	return newtype;
 }
 
-
-// Returns all datatype declarations
-auto getDatatypeMap(PAmsAddr pAddr, AdsSymbolUploadInfo2 info) {
-	std::map<std::string, TwinCatType> datatypes{};
-	auto [nErr, datatypeUpload] = getDatatypeUpload(pAddr, info);
-	if (nErr) return std::make_pair(nErr, datatypes);
-	PAdsDatatypeEntry datatypeEntry = (PAdsDatatypeEntry)datatypeUpload;
-	for (UINT uiIndex = 0; uiIndex < info.nDatatypes; uiIndex++)
-	{
-		std::string name{ PADSDATATYPENAME(datatypeEntry) };
-		datatypes[name] = getDatatype(datatypeEntry);
-		datatypeEntry = (*((unsigned long*)(((char*)datatypeEntry) + ((PAdsDatatypeEntry)datatypeEntry)->entryLength)) \
-			? ((PAdsDatatypeEntry)(((char*)datatypeEntry) + ((PAdsDatatypeEntry)datatypeEntry)->entryLength)) : NULL);
+// Values of at least this many bytes are decoded while they are sent
+constexpr size_t JSON_STREAM_THRESHOLD = 64 * 1024;
+
+// Sets response to value decoded into JSON text while it is sent in chunks, so large values are never materialized as a whole.
+// Chunks are compressed on the fly if the client accepts it.
+// Decoding errors can no longer turn the response into an error response, they are appended after the partially decoded data.
+static void setStreamedContent(const httplib::Request& req, httplib::Response& res, std::shared_ptr<const TwinCatSnapshot> snapshot, const TwinCatVar& variable, std::shared_ptr<const std::vector<char>> buffer, std::optional<int64_t> timestamp = std::nullopt) {
+	// Layout is owned by the snapshot, which the content provider keeps alive
+	const TwinCatLayout* layout = &snapshot->findLayout(variable);
+	ContentEncoding encoding = getContentEncoding(req.get_header_value("Accept-Encoding"));
+	if (encoding != ContentEncoding::Identity) {
+		res.set_header("Content-Encoding", getContentEncodingName(encoding));
+	}
+	res.set_header("Vary", "Accept, Accept-Encoding");
+	res.set_chunked_content_provider("text/json", [snapshot, layout, buffer, timestamp, encoding](size_t /*offset*/, httplib::DataSink& sink) {
+		StreamCompressor compressor{ encoding, [&sink](const char* data, size_t size) { return sink.write(data, size); } };
+	TwinCatJSONWriter writer{ [&compressor](const char* data, size_t size) { return compressor.write(data, size); } };
+	writer.append("{\"Data\":");
+	long nErr = writeVariableJSONValue(*layout, 0, *buffer, 0, writer);
+	if (nErr) {
+		writer.append(",\"Error\":\"ADS request unsuccessful.\",\"ErrorNum\":");
+		writer.appendNumber(nErr);
 	}
-	if (datatypeUpload) delete(datatypeUpload);
-	return std::make_pair(nErr, datatypes);
-}
-
-// Returns all symbol/variable declarations
-auto getSymbolMap(PAmsAddr pAddr, AdsSymbolUploadInfo2 info, std::map<std::string, TwinCatType> datatypes) {
-	std::map<std::string, TwinCatVar> symbols{};
-	auto [nErr, pchSymbols] = getSymbolUpload(pAddr, info);
-	if (nErr) return std::make_pair(nErr, symbols);
-	PAdsSymbolEntry pAdsSymbolEntry = (PAdsSymbolEntry)pchSymbols;
-	for (UINT uiIndex = 0; uiIndex < info.nSymbols; uiIndex++)
-	{
-		std::string name{ PADSSYMBOLNAME(pAdsSymbolEntry) };
-		ULONG indexGroup = pAdsSymbolEntry->iGroup;
-		ULONG indexOffset = pAdsSymbolEntry->iOffs;
-		ULONG size = pAdsSymbolEntry->size;
-		std::string type{ PADSSYMBOLTYPE(pAdsSymbolEntry) };
-		std::string comment{ PADSSYMBOLCOMMENT(pAdsSymbolEntry) };
-		TwinCatType datatype = datatypes[type];
-		symbols[name] = TwinCatVar{ name,indexGroup,indexOffset,size,type,comment,datatype };
-		pAdsSymbolEntry = PADSNEXTSYMBOLENTRY(pAdsSymbolEntry);
-	}
-	if (pchSymbols) delete(pchSymbols);
-	return std::make_pair(nErr, symbols);
-}
-
-std::pair<long, std::string> getVariableJSONValue(PAmsAddr pAddr, TwinCatType datatype, ULONG indexGroup, ULONG indexOffset, bool aryItem = false);
-
-// Adapted from: https://github.com/jisotalo/ads-client/blob/master/src/ads-client.js
-std::pair<std::string, ULONG> parseArray(PAmsAddr pAddr, TwinCatType datatype, ULONG indexGroup, ULONG indexOffset, ADS_UINT16 dim) {
-	std::stringstream rstream;
-	rstream << "[";
-	ULONG offset = indexOffset;
-	bool first = true;
-	for (ADS_UINT16 i = 0; i < datatype.arrayVector[dim].size; i++) {
-		if (!first) {
-			rstream << ",";
-		}
-		else {
-			first = false;
-		}
-		if ((dim + 1) < datatype.arrayVector.size()) {
-			auto [value, noffset] = parseArray(pAddr, datatype, indexGroup, offset, dim + 1);
-			rstream << value;
-			offset = noffset;
-		}
-		else {
-			rstream << getVariableJSONValue(pAddr, datatype, indexGroup, offset, true).second;
-			offset += datatype.size;
-		}
+	if (timestamp) {
+		writer.append(",\"Timestamp\":");
+		writer.appendNumber(*timestamp);
 	}
-	rstream << "]";
-	return std::make_pair(rstream.str(), offset);
+	writer.append('}');
+	if (!writer.flush() || !compressor.write(nullptr, 0, true)) return false;
+	sink.done();
+	return true;
+		});
 }
 
-// Reads value of symbol/variable and returns JSON string representation
-std::pair<long, std::string> getVariableJSONValue(PAmsAddr pAddr, TwinCatType datatype, ULONG indexGroup, ULONG indexOffset, bool aryItem) {
-	long nErr{};
-	std::cout << datatype.name << "," << datatype.type << "," << datatype.dataType << "\n";
-	std::string value;
-	if ((datatype.arrayVector.size() == 0 || aryItem) && datatype.subItems.size() > 0) {
-		std::stringstream vstream;
-		vstream << "{";
-		ULONG offset = indexOffset + datatype.offs;
-		bool first = true;
-		for (const auto& [key, value] : datatype.subItems) {
-			if (!first) {
-				vstream << ",";
+// Compressed and binary encoded symbol listings, built once per snapshot version, body encoding and content coding.
+// Plain JSON listings are not kept, they are streamed from the symbol table.
+class ListingCache {
+public:
+	// Returns listing of snapshot, nullptr if it could not be compressed
+	std::shared_ptr<const std::string> get(const TwinCatSnapshot& snapshot, BodyEncoding bodyEncoding, ContentEncoding contentEncoding) {
+		std::lock_guard lock{ mutex };
+		if (snapshot.version != version) {
+			listings.clear();
+			version = snapshot.version;
+		}
+		auto key = std::make_pair(bodyEncoding, contentEncoding);
+		if (auto it = listings.find(key); it != listings.end()) {
+			return it->second;
+		}
+		std::shared_ptr<const std::string> listing{};
+		if (bodyEncoding == BodyEncoding::Json) {
+			// Entries are compressed as they are written, so the plain listing is never materialized
+			std::string compressed{};
+			StreamCompressor compressor{ contentEncoding, [&compressed](const char* data, size_t size) {
+				compressed.append(data, size);
+				return true;
+			} };
+			TwinCatJSONWriter writer{ [&compressor](const char* data, size_t size) { return compressor.write(data, size); } };
+			writer.append('{');
+			writeSymbolEntries(snapshot.symbols.begin(), snapshot.symbols.end(), snapshot.symbols.size(), writer);
+			writer.append('}');
+			if (writer.flush() && compressor.write(nullptr, 0, true)) {
+				listing = std::make_shared<const std::string>(std::move(compressed));
 			}
-			else {
-				first = false;
-			}
-			vstream << "\"" << key << "\":";
-			auto [err, data] = getVariableJSONValue(pAddr, value, indexGroup, offset);
-			offset += value.size;
-			if (err) {
-				nErr = err;
-				vstream << "null";
+		}
+		else {
+			auto document = getDocument(snapshot, bodyEncoding);
+			if (contentEncoding == ContentEncoding::Identity) {
+				listing = document;
 			}
-			else {
-				vstream << data;
+			else if (auto compressed = compressBody(*document, contentEncoding)) {
+				listing = std::make_shared<const std::string>(std::move(*compressed));
 			}
 		}
-		vstream << "}";
-		value = vstream.str();
+		listings[key] = listing;
+		return listing;
 	}
-	else if (datatype.arrayVector.size() > 0 && !aryItem) {
-		value = parseArray(pAddr, datatype, indexGroup, indexOffset, 0).first;
-	}
-	else {
-		switch ((ADSDATATYPE)datatype.dataType)
-		{
-		case ADST_VOID:
-			value = "null";
-			break;
-		case ADST_BIT:
-		{
-			auto [err, data] = readGroupOffset(pAddr, indexGroup, indexOffset, bool{}, nErr);
-			value = (data ? "true" : "false");
-		}
-		break;
-		case ADST_INT8:
-			readGroupOffset(pAddr, indexGroup, indexOffset, INT8{}, nErr, value);
-			break;
-		case ADST_INT16:
-			readGroupOffset(pAddr, indexGroup, indexOffset, INT16{}, nErr, value);
-			break;
-		case ADST_INT32:
-			readGroupOffset(pAddr, indexGroup, indexOffset, INT32{}, nErr, value);
-			break;
-		case ADST_INT64:
-			readGroupOffset(pAddr, indexGroup, indexOffset, INT64{}, nErr, value);
-			break;
-		case ADST_UINT8:
-			readGroupOffset(pAddr, indexGroup, indexOffset, UINT8{}, nErr, value);
-			break;
-		case ADST_UINT16:
-			readGroupOffset(pAddr, indexGroup, indexOffset, UINT16{}, nErr, value);
-			break;
-		case ADST_UINT32:
-			readGroupOffset(pAddr, indexGroup, indexOffset, UINT32{}, nErr, value);
-			break;
-		case ADST_UINT64:
-			readGroupOffset(pAddr, indexGroup, indexOffset, UINT64{}, nErr, value);
-			break;
-		case ADST_REAL32:
-			readGroupOffset(pAddr, indexGroup, indexOffset, float{}, nErr, value);
-			break;
-		case ADST_REAL64:
-			readGroupOffset(pAddr, indexGroup, indexOffset, double{}, nErr, value);
-			break;
-		case ADST_STRING:
-		{
-			char pData[256];
-			nErr = AdsSyncReadReq(pAddr, indexGroup, indexOffset, datatype.size, &pData);
-			if (!nErr) {
-				std::string extendedValue{ pData };
-				std::stringstream vstream;
-				vstream << "\"" << extendedValue.substr(0, datatype.size) << "\"";
-				value = vstream.str();
-			}
-		}
-		break;
-		default:
-			nErr = ADSERR_DEVICE_INVALIDDATA;
-			break;
+
+private:
+	// Returns uncompressed listing in binary encoding, converted from its JSON text
+	std::shared_ptr<const std::string> getDocument(const TwinCatSnapshot& snapshot, BodyEncoding bodyEncoding) {
+		auto& listing = listings[std::make_pair(bodyEncoding, ContentEncoding::Identity)];
+		if (!listing) {
+			TwinCatJSONWriter writer{};
+			writer.append('{');
+			writeSymbolEntries(snapshot.symbols.begin(), snapshot.symbols.end(), snapshot.symbols.size(), writer);
+			writer.append('}');
+			nlohmann::json document = nlohmann::json::parse(writer.str());
+			std::vector<std::uint8_t> data = bodyEncoding == BodyEncoding::MsgPack ? nlohmann::json::to_msgpack(document) : nlohmann::json::to_cbor(document);
+			listing = std::make_shared<const std::string>(data.begin(), data.end());
 		}
+		return listing;
 	}
-	return std::pair(nErr, value);
-}
 
-auto getVariableJSONValue(PAmsAddr pAddr, std::map<std::string, TwinCatType> datatypes, TwinCatVar variable) {
-	// return getVariableJSONValue(pAddr, variable.datatype, variable.indexGroup, variable.indexOffset);
-	return getVariableJSONValue(pAddr, getDatatypeRecursive(datatypes, variable.datatype.name), variable.indexGroup, variable.indexOffset);
-}
+	std::mutex mutex;
+	uint64_t version = 0;
+	std::map<std::pair<BodyEncoding, ContentEncoding>, std::shared_ptr<const std::string>> listings;
+};
 
-long setVariableJSONValue(PAmsAddr pAddr, TwinCatType datatype, ULONG indexGroup, ULONG indexOffset, const nlohmann::json jsonValue, bool aryItem = false);
+// Symbols/variables per page of a listing if only the cursor is given
+constexpr size_t LISTING_PAGE_LIMIT = 1000;
 
-// Adapted from: https://github.com/jisotalo/ads-client/blob/master/src/ads-client.js
-std::pair<long, ULONG> unparseArray(PAmsAddr pAddr, TwinCatType datatype, ULONG indexGroup, ULONG indexOffset, const nlohmann::json jsonValue, ADS_UINT16 dim) {
-	long nErr{};
-	ULONG offset = indexOffset;
-	for (ADS_UINT16 i = 0; i < datatype.arrayVector[dim].size; i++) {
-		if ((dim + 1) < datatype.arrayVector.size()) {
-			auto [err, noffset] = unparseArray(pAddr, datatype, indexGroup, offset, jsonValue[i], dim + 1);
-			nErr = err;
-			offset = noffset;
-		}
-		else {
-			nErr = setVariableJSONValue(pAddr, datatype, indexGroup, offset, jsonValue[i], true);
-			offset += datatype.size;
-		}
-		if (nErr) {
-			break;
-		}
+// Parses request body in encoding given by Content-Type header, std::nullopt if body is malformed
+static std::optional<nlohmann::json> parseBody(const httplib::Request& req, const std::string& body) {
+	nlohmann::json json{};
+	switch (getBodyEncoding(req.get_header_value("Content-Type"))) {
+	case BodyEncoding::MsgPack:
+		json = nlohmann::json::from_msgpack(body, true, false);
+		break;
+	case BodyEncoding::Cbor:
+		json = nlohmann::json::from_cbor(body, true, false);
+		break;
+	default:
+		json = nlohmann::json::parse(body, nullptr, false);
+		break;
 	}
-	return std::make_pair(nErr, offset);
+	if (json.is_discarded()) return std::nullopt;
+	return json;
 }
 
-// Updates symbol/variable based on provided json value
-long setVariableJSONValue(PAmsAddr pAddr, TwinCatType datatype, ULONG indexGroup, ULONG indexOffset, const nlohmann::json jsonValue, bool aryItem) {
-	long nErr{};
-	if ((datatype.arrayVector.size() == 0 || aryItem) && datatype.subItems.size() > 0) {
-		for (const auto& [key, value] : datatype.subItems) {
-			if (!nErr) {
-				nErr = setVariableJSONValue(pAddr, value, indexGroup, indexOffset + value.offs, jsonValue[key]);
-			}
-		}
+// Returns format of request body given by Content-Type header
+static nlohmann::json::input_format_t getBodyFormat(const httplib::Request& req) {
+	switch (getBodyEncoding(req.get_header_value("Content-Type"))) {
+	case BodyEncoding::MsgPack:
+		return nlohmann::json::input_format_t::msgpack;
+	case BodyEncoding::Cbor:
+		return nlohmann::json::input_format_t::cbor;
+	default:
+		return nlohmann::json::input_format_t::json;
 	}
-	else if (datatype.arrayVector.size() > 0 && !aryItem) {
-		nErr = unparseArray(pAddr, datatype, indexGroup, indexOffset, jsonValue, 0).first;
-	}
-	else {
-		ADSDATATYPE type = (ADSDATATYPE)datatype.dataType;
-		if (type == ADST_VOID && jsonValue.is_null()) {
-		}
-		else if (type == ADST_BIT && jsonValue.is_boolean()) {
-			nErr = writeGroupOffset(pAddr, indexGroup, indexOffset, jsonValue.get<bool>());
-		}
-		else if (type == ADST_INT8 && jsonValue.is_number_integer()) {
-			nErr = writeGroupOffset(pAddr, indexGroup, indexOffset, jsonValue.get<int8_t>());
-		}
-		else if (type == ADST_INT16 && jsonValue.is_number_integer()) {
-			nErr = writeGroupOffset(pAddr, indexGroup, indexOffset, jsonValue.get<int16_t>());
-			}
-		else if (type == ADST_INT32 && jsonValue.is_number_integer()) {
-			nErr = writeGroupOffset(pAddr, indexGroup, indexOffset, jsonValue.get<int32_t>());
-		}
-		else if (type == ADST_INT64 && jsonValue.is_number_integer()) {
-			nErr = writeGroupOffset(pAddr, indexGroup, indexOffset, jsonValue.get<int64_t>());
-		}
-		else if (type == ADST_UINT8 && jsonValue.is_number_unsigned()) {
-			nErr = writeGroupOffset(pAddr, indexGroup, indexOffset, jsonValue.get<uint8_t>());
-		}
-		else if (type == ADST_UINT16 && jsonValue.is_number_unsigned()) {
-			nErr = writeGroupOffset(pAddr, indexGroup, indexOffset, jsonValue.get<uint16_t>());
-		}
-		else if (type == ADST_UINT32 && jsonValue.is_number_unsigned()) {
-			nErr = writeGroupOffset(pAddr, indexGroup, indexOffset, jsonValue.get<uint32_t>());
-		}
-		else if (type == ADST_UINT64 && jsonValue.is_number_unsigned()) {
-			nErr = writeGroupOffset(pAddr, indexGroup, indexOffset, jsonValue.get<uint64_t>());
-		}
-		else if (type == ADST_REAL32 && jsonValue.is_number_float()) {
-			nErr = writeGroupOffset(pAddr, indexGroup, indexOffset, jsonValue.get<float>());
-		}
-		else if (type == ADST_REAL64 && jsonValue.is_number_float()) {
-			nErr = writeGroupOffset(pAddr, indexGroup, indexOffset, jsonValue.get<double>());
-		}
-		else if (type == ADST_STRING && jsonValue.is_string()) {
-			std::string valueStr = jsonValue.get<std::string>();
-			nErr = AdsSyncWriteReq(pAddr, indexGroup, indexOffset, datatype.size, valueStr.data());
-		} else {
-			nErr = ADSERR_DEVICE_INVALIDDATA;
-		}
-	}
-	return nErr;
-}
-
-auto setVariableJSONValue(PAmsAddr pAddr, std::map<std::string, TwinCatType> datatypes, TwinCatVar variable, const nlohmann::json jsonValue) {
-	return setVariableJSONValue(pAddr, getDatatypeRecursive(datatypes, variable.datatype.name), variable.indexGroup, variable.indexOffset, jsonValue);
 }
 
 int main(int argc, const char** argv)
@@ -493,27 +216,77 @@ int main(int argc, const char** argv)
 	std::string DLLVersionStr{ dllstrstream.str() };
 	std::cout << DLLVersionStr << '\n';
 
-	// Map for storing symbol/variable definitions
-	std::map<std::string, TwinCatVar> symbols{};
-	std::map<std::string, TwinCatType> datatypes{};
+	// Snapshot of symbol/variable definitions, replaced atomically by the update thread and pinned by every request
+	std::atomic<std::shared_ptr<const TwinCatSnapshot>> snapshot{ std::make_shared<const TwinCatSnapshot>() };
+
+	// Cache for symbol/variable handles
+	TwinCatHandleCache handles{};
+
+	// Cache for values of subscribed symbols/variables
+	TwinCatNotificationCache notifications{};
+
+	// In-flight reads shared by concurrent requests
+	TwinCatReadGroup reads{};
+
+	// Layout descriptors for clients decoding raw values
+	TwinCatLayoutCache descriptors{};
+
+	// Symbol listings, compressed ones included
+	ListingCache listings{};
+
+	// Symbols/variables at most this many bytes apart are read as one range
+	const char* mergeGapStr = getenv("ADS_MERGE_GAP");
+	ULONG mergeGap = MAX_MERGE_GAP;
+	if (mergeGapStr) {
+		std::string_view value{ mergeGapStr };
+		ULONG parsed{};
+		auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), parsed);
+		if (ec == std::errc{} && end == value.data() + value.size()) {
+			mergeGap = parsed;
+		}
+		else {
+			std::cerr << "Warning: Invalid ADS_MERGE_GAP \"" << value << "\", using " << MAX_MERGE_GAP << '\n';
+		}
+	}
 
 	// Regulary fetch infromation about symbols/variables
 	std::cout << "Starting symbol declaration update thread..." << '\n';
-	std::jthread t1([pAddr, &symbols, &datatypes] {
-		using namespace std::chrono_literals;
-	while (true) {
-		auto [nErr, uploadInfo] = getUploadInfo(pAddr);
-		if (!nErr) {
-			datatypes = getDatatypeMap(pAddr, uploadInfo).second;
-			symbols = getSymbolMap(pAddr, uploadInfo, datatypes).second;
+	std::jthread t1([pAddr, &snapshot, &handles, &notifications](std::stop_token stopToken) {
+		// Symbol and datatype uploads are only fetched again if symbol version or upload sizes changed
+		AdsSymbolUploadInfo2 lastUploadInfo{};
+	UCHAR lastVersion{};
+	bool loaded = false;
+	TwinCatSymbolVersionWatch versionWatch{};
+	if (versionWatch.start(pAddr)) std::cout << "Symbol version notification unavailable, polling every " << SYMBOL_POLL_INTERVAL.count() << "s..." << '\n';
+	while (!stopToken.stop_requested()) {
+		auto [nErr, version] = getSymbolVersion(pAddr);
+		auto [infoErr, uploadInfo] = getUploadInfo(pAddr);
+		if (!nErr && !infoErr && (!loaded || version != lastVersion || memcmp(&uploadInfo, &lastUploadInfo, sizeof(uploadInfo)) != 0)) {
+			// Handles of the previous symbol table are released as soon as it changes
+			handles.release(pAddr);
+			auto [datatypeErr, newDatatypes] = getDatatypeMap(pAddr, uploadInfo);
+			auto [symbolErr, newSymbols] = getSymbolTable(pAddr, uploadInfo);
+			if (!datatypeErr && !symbolErr) {
+				// New snapshot is built off to the side, requests keep using the previous one until it is published
+				auto layouts = getLayoutMap(newDatatypes, newSymbols);
+				auto index = getSymbolIndex(newSymbols);
+				auto current = std::make_shared<const TwinCatSnapshot>(TwinCatSnapshot{ std::move(newSymbols), std::move(newDatatypes), std::move(layouts), std::move(index), snapshot.load()->version + 1 });
+				snapshot.store(current);
+				notifications.refresh(pAddr, current->symbols);
+				lastVersion = version;
+				lastUploadInfo = uploadInfo;
+				loaded = true;
+			}
 		}
-		std::this_thread::sleep_for(5s);
+		notifications.expire(pAddr);
+		versionWatch.wait(stopToken, SYMBOL_POLL_INTERVAL);
 	}
+	versionWatch.stop(pAddr);
 		});
 
 	// Outputs DLL version information as json string
 	svr.Get("/version", [DLLVersionStr](const httplib::Request& req, httplib::Response& res) {
-		res.set_content(DLLVersionStr, "text/json");
+		setContent(req, res, DLLVersionStr);
 		});
 
 	// Gets status of PLC
@@ -531,7 +304,7 @@ int main(int argc, const char** argv)
 		strstream << "\"Device\":" << nDeviceState << '}';
 	}
 
-	res.set_content(strstream.str(), "text/json");
+	setContent(req, res, strstream.str());
 		});
 
 	// Gets device info of ADS server
@@ -553,7 +326,7 @@ int main(int argc, const char** argv)
 		strstream << "\"Build\":" << pVersion->build << "}}";
 	}
 
-	res.set_content(strstream.str(), "text/json");
+	setContent(req, res, strstream.str());
 		});
 
 	// Reads data
@@ -581,14 +354,14 @@ int main(int argc, const char** argv)
 		}
 	}
 
-	res.set_content(strstream.str(), "text/json");
+	setContent(req, res, strstream.str());
 		});
 
 	// Get handle of variable
-	svr.Get(R"(/symbol/((\w|\.)+)/handle)", [pAddr](const httplib::Request& req, httplib::Response& res) {
+	svr.Get(R"(/symbol/((\w|\.|\[|\]|,|-)+)/handle)", [pAddr, &handles](const httplib::Request& req, httplib::Response& res) {
 		std::vector<std::string> paths = splitPath(req.path);
 	std::string nameStr = paths.at(2);
-	auto [nErr, symHandle] = getSymHandleByName(pAddr, nameStr);
+	auto [nErr, symHandle] = handles.acquire(pAddr, nameStr);
 	std::stringstream strstream;
 	if (nErr) {
 		strstream << "{\"Error\":\"ADS request unsuccessful.\",\"ErrorNum\":" << nErr << '}';
@@ -597,90 +370,534 @@ int main(int argc, const char** argv)
 		strstream << "{\"Handle\":" << symHandle << "}";
 	}
 
-	res.set_content(strstream.str(), "text/json");
+	setContent(req, res, strstream.str());
 		});
 
 	// Get info of all variables
-	svr.Get(R"(/symbol)", [pAddr, &symbols](const httplib::Request& req, httplib::Response& res) {
-		std::stringstream strstream;
-	strstream << "{";
-	bool first = true;
-	for (const auto& [key, value] : symbols) {
-		if (!first) {
-			strstream << ",";
+	svr.Get(R"(/symbol)", [pAddr, &snapshot, &listings](const httplib::Request& req, httplib::Response& res) {
+		auto current = snapshot.load();
+	// Symbols/variables found by name prefix, glob pattern over names or type names, or text of comments, case insensitive
+	bool search = req.has_param("prefix") || req.has_param("match") || req.has_param("type") || req.has_param("comment");
+	// Pages of at most limit symbols/variables in name order, continued after the Next name of the previous page
+	if (search || req.has_param("limit") || req.has_param("after")) {
+		size_t limit = LISTING_PAGE_LIMIT;
+		if (req.has_param("limit")) {
+			const std::string& limitStr = req.get_param_value("limit");
+			auto [end, ec] = std::from_chars(limitStr.data(), limitStr.data() + limitStr.size(), limit);
+			if (ec != std::errc{} || end != limitStr.data() + limitStr.size() || limit == 0) {
+				setContent(req, res, std::string("{\"Error\":\"Invalid limit.\",\"ErrorNum\":400}"));
+				return;
+			}
+		}
+		if (search) {
+			TwinCatSymbolQuery query{ req.get_param_value("prefix"), req.get_param_value("match"), req.get_param_value("type"), req.get_param_value("comment") };
+			setContent(req, res, findSymbols(*current, query, req.get_param_value("after"), limit));
 		}
 		else {
-			first = false;
+			setContent(req, res, getSymbolPage(*current, req.get_param_value("after"), limit));
+		}
+		return;
+	}
+	res.set_header("Vary", "Accept, Accept-Encoding");
+	BodyEncoding bodyEncoding = getBodyEncoding(req.get_header_value("Accept"));
+	ContentEncoding contentEncoding = getContentEncoding(req.get_header_value("Accept-Encoding"));
+	if (bodyEncoding != BodyEncoding::Json || contentEncoding != ContentEncoding::Identity) {
+		// Compressed and binary listings are built once per snapshot version, later requests only send them
+		if (auto listing = listings.get(*current, bodyEncoding, contentEncoding)) {
+			if (contentEncoding != ContentEncoding::Identity) {
+				res.set_header("Content-Encoding", getContentEncodingName(contentEncoding));
+			}
+			const char* contentType = bodyEncoding == BodyEncoding::MsgPack ? "application/msgpack" : bodyEncoding == BodyEncoding::Cbor ? "application/cbor" : "text/json";
+			res.set_content_provider(listing->size(), contentType, [listing](size_t offset, size_t length, httplib::DataSink& sink) {
+				return sink.write(listing->data() + offset, length);
+				});
+			return;
 		}
-		strstream << "\"" + key + "\":" + value.str();
 	}
-	strstream << "}";
-
-	res.set_content(strstream.str(), "text/json");
+	// Streamed a chunk of symbols/variables at a time, so memory per connection stays bounded however large the symbol table is
+	auto position = std::make_shared<TwinCatSymbolTable::const_iterator>(current->symbols.begin());
+	res.set_chunked_content_provider("text/json", [current, position](size_t /*offset*/, httplib::DataSink& sink) {
+		TwinCatJSONWriter writer{ [&sink](const char* data, size_t size) { return sink.write(data, size); } };
+	bool first = *position == current->symbols.begin();
+	if (first) writer.append('{');
+	*position = writeSymbolEntries(*position, current->symbols.end(), LISTING_CHUNK_SYMBOLS, writer, first);
+	bool last = *position == current->symbols.end();
+	if (last) writer.append('}');
+	if (!writer.flush()) return false;
+	if (last) sink.done();
+	return true;
+		});
 		});
 
 	// Get info of variable
-	svr.Get(R"(/symbol/((\w|\.)+))", [pAddr, &symbols](const httplib::Request& req, httplib::Response& res) {
+	svr.Get(R"(/symbol/((\w|\.|\[|\]|,|-)+))", [pAddr, &snapshot](const httplib::Request& req, httplib::Response& res) {
 		std::vector<std::string> paths = splitPath(req.path);
 	std::string nameStr = paths.at(2);
 	std::stringstream strstream;
-	if (!symbols.contains(nameStr)) {
+	auto current = snapshot.load();
+	// Members of symbols/variables are addressed by their path, e.g. MAIN.fbAxis.stStatus or MAIN.aPoints[2].nX
+	std::optional<TwinCatMember> member{};
+	const TwinCatVar* variable = findVariable(*current, nameStr, member);
+	if (!variable) {
 		strstream << "{\"Error\":\"Symbol/Variable not found.\",\"ErrorNum\":" << 404 << '}';
 	}
 	else {
-		TwinCatVar variable = symbols[nameStr];
-		strstream << variable.str();
+		strstream << variable->str();
 	}
 
-	res.set_content(strstream.str(), "text/json");
+	setContent(req, res, strstream.str());
 		});
 
-	svr.Get(R"(/symbol/((\w|\.)+)/value)", [pAddr, &symbols, &datatypes](const httplib::Request& req, httplib::Response& res) {
+	svr.Get(R"(/symbol/((\w|\.|\[|\]|,|-)+)/value)", [pAddr, &snapshot, &handles, &notifications, &reads, mergeGap](const httplib::Request& req, httplib::Response& res) {
 		std::vector<std::string> paths = splitPath(req.path);
 	std::string nameStr = paths.at(2);
 	std::stringstream strstream;
-	if (!symbols.contains(nameStr)) {
+	// Subscribed symbols/variables are answered from the notification cache unless its value is older than maxAge milliseconds
+	auto maxAge = std::chrono::milliseconds::max();
+	bool validMaxAge = true;
+	if (req.has_param("maxAge")) {
+		const std::string& maxAgeStr = req.get_param_value("maxAge");
+		unsigned long maxAgeMs{};
+		auto [end, ec] = std::from_chars(maxAgeStr.data(), maxAgeStr.data() + maxAgeStr.size(), maxAgeMs);
+		validMaxAge = ec == std::errc{} && end == maxAgeStr.data() + maxAgeStr.size();
+		maxAge = std::chrono::milliseconds(std::min<unsigned long long>(maxAgeMs, std::chrono::milliseconds::max().count()));
+	}
+	auto current = snapshot.load();
+	// Members of symbols/variables are addressed by their path, e.g. MAIN.fbAxis.stStatus or MAIN.aPoints[2].nX
+	std::optional<TwinCatMember> member{};
+	const TwinCatVar* variable = findVariable(*current, nameStr, member);
+	// Only members given by comma separated dotted paths are read and returned, e.g. ?fields=axis.actPos,axis.status.error
+	std::optional<std::vector<TwinCatField>> fields{};
+	if (variable && req.has_param("fields")) {
+		fields = getLayoutFields(current->findLayout(*variable), splitPath(req.get_param_value("fields"), ","));
+	}
+	// Only elements within the inclusive index range of each array dimension are read and returned, e.g. ?slice=99900:99999
+	std::optional<TwinCatSlice> slice{};
+	if (variable && req.has_param("slice")) {
+		slice = getLayoutSlice(current->findLayout(*variable), 0, req.get_param_value("slice"));
+	}
+	// Bytes of whole values or slices are returned as read with ?format=raw, clients decode them with the descriptor of /symbol/<name>/layout
+	std::string format = req.has_param("format") ? req.get_param_value("format") : "json";
+	bool raw = format == "raw";
+	// Whole values are decoded into JSON documents for binary encodings, projections are converted from their JSON text
+	bool asDocument = !raw && !fields && !slice && getBodyEncoding(req.get_header_value("Accept")) != BodyEncoding::Json;
+	bool stream = variable && !raw && !asDocument && !fields && !slice && variable->size >= JSON_STREAM_THRESHOLD;
+	if (!variable) {
+		strstream << "{\"Error\":\"Symbol/Variable not found.\",\"ErrorNum\":" << 404 << '}';
+	}
+	else if (!validMaxAge) {
+		strstream << "{\"Error\":\"Invalid maxAge.\",\"ErrorNum\":" << 400 << '}';
+	}
+	else if (req.has_param("fields") && !fields) {
+		strstream << "{\"Error\":\"Field not found.\",\"ErrorNum\":" << 404 << '}';
+	}
+	else if ((req.has_param("slice") && !slice) || (fields && slice)) {
+		strstream << "{\"Error\":\"Invalid slice.\",\"ErrorNum\":" << 400 << '}';
+	}
+	else if ((!raw && format != "json") || (raw && fields)) {
+		strstream << "{\"Error\":\"Invalid format.\",\"ErrorNum\":" << 400 << '}';
+	}
+	else if (auto cached = notifications.get(nameStr, maxAge); cached && raw) {
+		auto& [buffer, timestamp] = *cached;
+		std::span<const char> data{ buffer };
+		if (slice) {
+			data = slice->offset + slice->size <= data.size() ? data.subspan(slice->offset, slice->size) : std::span<const char>{};
+		}
+		res.set_header("X-Timestamp", std::to_string(getUnixTimestamp(timestamp)));
+		setBody(req, res, std::string(data.begin(), data.end()), "application/octet-stream");
+		return;
+	}
+	else if (cached && stream) {
+		auto& [buffer, timestamp] = *cached;
+		setStreamedContent(req, res, current, *variable, std::make_shared<const std::vector<char>>(std::move(buffer)), timestamp);
+		return;
+	}
+	else if (cached && asDocument) {
+		auto& [buffer, timestamp] = *cached;
+		auto [nErr, document] = getVariableJSONDocument(*current, *variable, buffer);
+		if (nErr) {
+			strstream << "{\"Error\":\"ADS request unsuccessful.\",\"ErrorNum\":" << nErr << '}';
+		}
+		else {
+			setContent(req, res, nlohmann::json{ { "Data", std::move(document) }, { "Timestamp", getUnixTimestamp(timestamp) } });
+			return;
+		}
+	}
+	else if (cached) {
+		auto& [buffer, timestamp] = *cached;
+		auto [nErr, value] = fields ? getFieldsJSONValue(*current, *variable, *fields, buffer)
+			: slice ? getSliceJSONValue(*current, *variable, *slice, buffer)
+			: getVariableJSONValue(*current, *variable, buffer);
+		if (nErr) {
+			strstream << "{\"Error\":\"ADS request unsuccessful.\",\"ErrorNum\":" << nErr << '}';
+		}
+		else {
+			strstream << "{\"Data\":" << value << ",\"Timestamp\":" << getUnixTimestamp(timestamp) << "}";
+		}
+	}
+	else if (raw && slice) {
+		auto [nErr, buffer] = readSliceBuffer(pAddr, *variable, *slice);
+		if (nErr) {
+			strstream << "{\"Error\":\"ADS request unsuccessful.\",\"ErrorNum\":" << nErr << '}';
+		}
+		else {
+			setBody(req, res, std::string(buffer.begin(), buffer.end()), "application/octet-stream");
+			return;
+		}
+	}
+	else if (fields || slice) {
+		// Members and slices are read by index group and offset, so handles are not used
+		auto [nErr, value] = fields ? getFieldsJSONValue(pAddr, *current, *variable, *fields, mergeGap) : getSliceJSONValue(pAddr, *current, *variable, *slice);
+		if (nErr) {
+			strstream << "{\"Error\":\"ADS request unsuccessful.\",\"ErrorNum\":" << nErr << '}';
+		}
+		else {
+			strstream << "{\"Data\":" << value << "}";
+		}
+	}
+	else {
+		// Concurrent requests for the same symbol/variable share a single ADS read
+		auto decoding = raw || stream ? TwinCatDecoding::Raw : asDocument ? TwinCatDecoding::Document : TwinCatDecoding::Json;
+		auto result = reads.read(pAddr, *current, *variable, req.has_param("handle") ? &handles : nullptr, decoding);
+		if (result->nErr) {
+			strstream << "{\"Error\":\"ADS request unsuccessful.\",\"ErrorNum\":" << result->nErr << '}';
+		}
+		else if (raw) {
+			setBody(req, res, std::string(result->buffer.begin(), result->buffer.end()), "application/octet-stream");
+			return;
+		}
+		else if (stream) {
+			setStreamedContent(req, res, current, *variable, std::shared_ptr<const std::vector<char>>(result, &result->buffer));
+			return;
+		}
+		else if (asDocument) {
+			setContent(req, res, nlohmann::json{ { "Data", result->document } });
+			return;
+		}
+		else {
+			strstream << "{\"Data\":" << result->value << "}";
+		}
+	}
+
+	setContent(req, res, strstream.str());
+		});
+
+	// Get flattened layout of variable, describing the bytes returned by ?format=raw
+	svr.Get(R"(/symbol/((\w|\.|\[|\]|,|-)+)/layout)", [&snapshot, &descriptors](const httplib::Request& req, httplib::Response& res) {
+		std::vector<std::string> paths = splitPath(req.path);
+	std::string nameStr = paths.at(2);
+	std::stringstream strstream;
+	auto current = snapshot.load();
+	std::optional<TwinCatMember> member{};
+	const TwinCatVar* variable = findVariable(*current, nameStr, member);
+	if (!variable) {
+		strstream << "{\"Error\":\"Symbol/Variable not found.\",\"ErrorNum\":" << 404 << '}';
+		setContent(req, res, strstream.str());
+		return;
+	}
+
+	setContent(req, res, *descriptors.get(*current, *variable));
+		});
+
+	// Subscribes to changes of variable, subsequent value reads are answered from the notification cache
+	svr.Post(R"(/symbol/((\w|\.|\[|\]|,|-)+)/subscribe)", [pAddr, &snapshot, &notifications](const httplib::Request& req, httplib::Response& res, const httplib::ContentReader& content_reader) {
+		std::vector<std::string> paths = splitPath(req.path);
+	std::string nameStr = paths.at(2);
+	std::stringstream strstream;
+	std::string body;
+	content_reader([&](const char* data, size_t data_length) {
+		body.append(data, data_length);
+	return true;
+		});
+	auto parsed = body.empty() ? std::optional(nlohmann::json::object()) : parseBody(req, body);
+	if (!parsed) {
+		setContent(req, res, std::string("{\"Error\":\"Malformed body.\",\"ErrorNum\":400}"));
+		return;
+	}
+	auto& json = *parsed;
+	// Settings must have the right types, json.value would throw on any other
+	auto isUnsigned = [&json](const char* key) { return !json.contains(key) || json[key].is_number_unsigned(); };
+	if (!json.is_object() || (json.contains("Mode") && !json["Mode"].is_string()) || !isUnsigned("CycleTime") || !isUnsigned("MaxDelay") || !isUnsigned("IdleTimeout")) {
+		setContent(req, res, std::string("{\"Error\":\"Malformed body.\",\"ErrorNum\":400}"));
+		return;
+	}
+	std::string mode = json.value("Mode", "OnChange");
+	if (mode != "OnChange" && mode != "Cyclic") {
+		strstream << "{\"Error\":\"Mode must be OnChange or Cyclic.\"}";
+		setContent(req, res, strstream.str());
+		return;
+	}
+	// Times are passed to ADS in 100ns units, which must fit into ULONG
+	constexpr uint64_t maxTime = std::numeric_limits<ULONG>::max() / 10000;
+	if (json.value("CycleTime", uint64_t{ 100 }) > maxTime || json.value("MaxDelay", uint64_t{ 0 }) > maxTime) {
+		strstream << "{\"Error\":\"CycleTime and MaxDelay must not exceed " << maxTime << " ms.\",\"ErrorNum\":" << 400 << '}';
+		setContent(req, res, strstream.str());
+		return;
+	}
+	ULONG cycleTime = json.value("CycleTime", ULONG{ 100 });
+	ULONG maxDelay = json.value("MaxDelay", ULONG{ 0 });
+	std::chrono::seconds idleTimeout{ json.value("IdleTimeout", 60) };
+	auto current = snapshot.load();
+	// Members of symbols/variables are addressed by their path, e.g. MAIN.fbAxis.stStatus or MAIN.aPoints[2].nX
+	std::optional<TwinCatMember> member{};
+	const TwinCatVar* variable = findVariable(*current, nameStr, member);
+	if (!variable) {
 		strstream << "{\"Error\":\"Symbol/Variable not found.\",\"ErrorNum\":" << 404 << '}';
 	}
 	else {
-		TwinCatVar variable = symbols[nameStr];
-		auto [nErr, value] = getVariableJSONValue(pAddr, datatypes, variable);
+		long nErr = notifications.subscribe(pAddr, *variable, mode == "Cyclic" ? ADSTRANS_SERVERCYCLE : ADSTRANS_SERVERONCHA, cycleTime, maxDelay, idleTimeout);
 		if (nErr) {
 			strstream << "{\"Error\":\"ADS request unsuccessful.\",\"ErrorNum\":" << nErr << '}';
 		}
+		else {
+			strstream << "{\"Mode\":\"" << mode << "\",\"CycleTime\":" << cycleTime << ",\"MaxDelay\":" << maxDelay << ",\"IdleTimeout\":" << idleTimeout.count() << "}";
+		}
+	}
+
+	setContent(req, res, strstream.str());
+		});
+
+	// Unsubscribes from changes of variable
+	svr.Delete(R"(/symbol/((\w|\.|\[|\]|,|-)+)/subscribe)", [pAddr, &notifications](const httplib::Request& req, httplib::Response& res) {
+		std::vector<std::string> paths = splitPath(req.path);
+	std::string nameStr = paths.at(2);
+	std::stringstream strstream;
+	long nErr = notifications.unsubscribe(pAddr, nameStr);
+	if (nErr) {
+		strstream << "{\"Error\":\"ADS request unsuccessful.\",\"ErrorNum\":" << nErr << '}';
+	}
+	else {
+		strstream << "{}";
+	}
+
+	setContent(req, res, strstream.str());
+		});
+
+	// Reads values of multiple variables using as few ADS requests as possible
+	svr.Post(R"(/symbols/values)", [pAddr, &snapshot, &handles, mergeGap](const httplib::Request& req, httplib::Response& res, const httplib::ContentReader& content_reader) {
+		std::stringstream strstream;
+	std::string body;
+	content_reader([&](const char* data, size_t data_length) {
+		body.append(data, data_length);
+	return true;
+		});
+	auto parsed = parseBody(req, body);
+	if (!parsed) {
+		setContent(req, res, std::string("{\"Error\":\"Malformed body.\",\"ErrorNum\":400}"));
+		return;
+	}
+	auto& json = *parsed;
+	if (!json.contains("Symbols") || !json["Symbols"].is_array()) {
+		strstream << "{\"Error\":\"Symbols must be array of symbol/variable names.\"}";
+		setContent(req, res, strstream.str());
+		return;
+	}
+	auto current = snapshot.load();
+	std::vector<std::string> names{};
+	std::vector<const TwinCatVar*> variables{};
+	std::deque<TwinCatMember> members{};
+	for (const auto& name : json["Symbols"]) {
+		if (!name.is_string()) {
+			strstream << "{\"Error\":\"Symbols must be array of symbol/variable names.\"}";
+			setContent(req, res, strstream.str());
+			return;
+		}
+		std::string nameStr = name.get<std::string>();
+		if (std::find(names.begin(), names.end(), nameStr) != names.end()) continue;
+		names.push_back(nameStr);
+		std::optional<TwinCatMember> member{};
+		if (const TwinCatVar* variable = findVariable(*current, nameStr, member)) {
+			variables.push_back(member ? &members.emplace_back(std::move(*member)) : variable);
+		}
+	}
+	auto buffers = req.has_param("handle") ? readVariableBuffersByHandle(pAddr, handles, variables) : readMergedBuffers(pAddr, getVariableRanges(variables), mergeGap);
+	// Binary encodings are built from JSON documents decoded directly from the buffers
+	if (getBodyEncoding(req.get_header_value("Accept")) != BodyEncoding::Json) {
+		nlohmann::json document = nlohmann::json::object();
+		size_t index = 0;
+		for (const std::string& nameStr : names) {
+			if (index >= variables.size() || variables[index]->name != nameStr) {
+				document[nameStr] = { { "Error", "Symbol/Variable not found." }, { "ErrorNum", 404 } };
+				continue;
+			}
+			auto& [nErr, buffer] = buffers[index];
+			auto [err, value] = nErr ? std::pair(nErr, nlohmann::json{}) : getVariableJSONDocument(*current, *variables[index], buffer);
+			index++;
+			if (err) {
+				document[nameStr] = { { "Error", "ADS request unsuccessful." }, { "ErrorNum", err } };
+			}
+			else {
+				document[nameStr] = { { "Data", std::move(value) } };
+			}
+		}
+		setContent(req, res, document);
+		return;
+	}
+	strstream << "{";
+	size_t index = 0;
+	for (size_t i = 0; i < names.size(); i++) {
+		if (i > 0) {
+			strstream << ",";
+		}
+		strstream << nlohmann::json(names[i]).dump() << ":";
+		if (index >= variables.size() || variables[index]->name != names[i]) {
+			strstream << "{\"Error\":\"Symbol/Variable not found.\",\"ErrorNum\":" << 404 << '}';
+			continue;
+		}
+		auto& [nErr, buffer] = buffers[index];
+		auto [err, value] = nErr ? std::pair(nErr, std::string{}) : getVariableJSONValue(*current, *variables[index], buffer);
+		index++;
+		if (err) {
+			strstream << "{\"Error\":\"ADS request unsuccessful.\",\"ErrorNum\":" << err << '}';
+		}
 		else {
 			strstream << "{\"Data\":" << value << "}";
 		}
 	}
+	strstream << "}";
 
-	res.set_content(strstream.str(), "text/json");
+	setContent(req, res, strstream.str());
 		});
 
-	svr.Post(R"(/symbol/((\w|\.)+)/value)", [pAddr, &symbols, &datatypes](const httplib::Request& req, httplib::Response& res, const httplib::ContentReader& content_reader) {
+	// Writes values of multiple variables using as few ADS requests as possible
+	svr.Post(R"(/symbols/write)", [pAddr, &snapshot](const httplib::Request& req, httplib::Response& res, const httplib::ContentReader& content_reader) {
+		std::stringstream strstream;
+	std::string body;
+	content_reader([&](const char* data, size_t data_length) {
+		body.append(data, data_length);
+	return true;
+		});
+	auto parsed = parseBody(req, body);
+	if (!parsed) {
+		setContent(req, res, std::string("{\"Error\":\"Malformed body.\",\"ErrorNum\":400}"));
+		return;
+	}
+	auto& json = *parsed;
+	if (!json.contains("Symbols") || !json["Symbols"].is_object()) {
+		strstream << "{\"Error\":\"Symbols must be object of symbol/variable names and values.\"}";
+		setContent(req, res, strstream.str());
+		return;
+	}
+	auto current = snapshot.load();
+	std::map<std::string, long> errors{};
+	// Unknown names are kept apart, as 404 could also be an ADS error code
+	std::set<std::string> unknown{};
+	std::vector<const TwinCatVar*> variables{};
+	std::vector<std::vector<char>> buffers{};
+	std::deque<TwinCatMember> members{};
+	for (const auto& [nameStr, value] : json["Symbols"].items()) {
+		std::optional<TwinCatMember> member{};
+		const TwinCatVar* variable = findVariable(*current, nameStr, member);
+		if (member) {
+			variable = &members.emplace_back(std::move(*member));
+		}
+		if (!variable) {
+			unknown.insert(nameStr);
+			errors[nameStr] = 404;
+			continue;
+		}
+		auto [nErr, buffer] = setVariableJSONValue(*current, *variable, value);
+		errors[nameStr] = nErr;
+		if (!nErr) {
+			variables.push_back(variable);
+			buffers.push_back(std::move(buffer));
+		}
+	}
+	auto writeErrors = writeVariableBuffers(pAddr, getVariableRanges(variables), buffers);
+	for (size_t i = 0; i < variables.size(); i++) {
+		errors[std::string(variables[i]->name)] = writeErrors[i];
+	}
+	strstream << "{";
+	bool first = true;
+	for (const auto& [nameStr, nErr] : errors) {
+		if (!first) {
+			strstream << ",";
+		}
+		else {
+			first = false;
+		}
+		strstream << nlohmann::json(nameStr).dump() << ":";
+		if (unknown.contains(nameStr)) {
+			strstream << "{\"Error\":\"Symbol/Variable not found.\",\"ErrorNum\":" << nErr << '}';
+		}
+		else if (nErr) {
+			strstream << "{\"Error\":\"ADS request unsuccessful.\",\"ErrorNum\":" << nErr << '}';
+		}
+		else {
+			strstream << "{\"ErrorNum\":" << nErr << '}';
+		}
+	}
+	strstream << "}";
+
+	setContent(req, res, strstream.str());
+		});
+
+	svr.Post(R"(/symbol/((\w|\.|\[|\]|,|-)+)/value)", [pAddr, &snapshot](const httplib::Request& req, httplib::Response& res, const httplib::ContentReader& content_reader) {
 		std::vector<std::string> paths = splitPath(req.path);
 	std::string nameStr = paths.at(2);
 	std::stringstream strstream;
-	if (!symbols.contains(nameStr)) {
+	auto current = snapshot.load();
+	// Members of symbols/variables are addressed by their path, e.g. MAIN.fbAxis.stStatus or MAIN.aPoints[2].nX
+	std::optional<TwinCatMember> member{};
+	const TwinCatVar* variable = findVariable(*current, nameStr, member);
+	// Only the elements within the index ranges are written, which must be adjacent in memory
+	std::optional<TwinCatSlice> slice{};
+	if (variable && req.has_param("slice")) {
+		slice = getLayoutSlice(current->findLayout(*variable), 0, req.get_param_value("slice"));
+	}
+	if (!variable) {
 		strstream << "{\"Error\":\"Symbol/Variable not found.\",\"ErrorNum\":" << 404 << '}';
 	}
+	else if (req.has_param("slice") && !slice) {
+		strstream << "{\"Error\":\"Invalid slice.\",\"ErrorNum\":" << 400 << '}';
+	}
+	else if (slice && !slice->contiguous) {
+		strstream << "{\"Error\":\"Slice is not contiguous.\",\"ErrorNum\":" << 400 << '}';
+	}
 	else {
-		TwinCatVar variable = symbols[nameStr];
 		std::string body;
 		content_reader([&](const char* data, size_t data_length) {
 			body.append(data, data_length);
 		return true;
 			});
-		auto json = nlohmann::json::parse(body);
-		long nErr = setVariableJSONValue(pAddr, datatypes, variable, json["Data"]);
-		if (nErr) {
+		// Both branches report malformed bodies and unsuccessful writes the same way
+		bool valid = true;
+		long nErr = 0;
+		std::string echo{};
+		if (slice) {
+			auto json = parseBody(req, body);
+			valid = json.has_value();
+			// Bodies which are no object lack Data, which the direct decoder rejects as invalid data too
+			if (valid) {
+				nErr = json->is_object() ? setSliceJSONValue(pAddr, *current, *variable, *slice, (*json)["Data"]) : static_cast<long>(ADSERR_DEVICE_INVALIDDATA);
+			}
+			if (valid && !nErr) {
+				// Echoed as JSON text, converted to the encoding requested by Accept header like any other response
+				echo = json->dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+			}
+		}
+		else {
+			// Body is decoded straight into the bytes of symbol/variable while it is parsed, which are then written with a single ADS request
+			auto result = setVariableJSONBody(pAddr, *current, *variable, body, getBodyFormat(req));
+			valid = result.valid;
+			nErr = result.nErr;
+			if (valid && !nErr) {
+				// Echoes the value as it was written
+				echo = "{\"Data\":" + getVariableJSONValue(*current, *variable, result.buffer).second + '}';
+			}
+		}
+		if (!valid) {
+			strstream << "{\"Error\":\"Malformed body.\",\"ErrorNum\":" << 400 << '}';
+		}
+		else if (nErr) {
 			strstream << "{\"Error\":\"ADS request unsuccessful.\",\"ErrorNum\":" << nErr << '}';
 		}
 		else {
-			strstream << body;
+			strstream << echo;
 		}
 	}
 
-	res.set_content(strstream.str(), "text/json");
+	setContent(req, res, strstream.str());
 		});
 
 	svr.Post(R"(/state)", [pAddr](const httplib::Request& req, httplib::Response& res, const httplib::ContentReader& content_reader) {
@@ -691,7 +908,12 @@ int main(int argc, const char** argv)
 		body.append(data, data_length);
 	return true;
 		});
-	auto json = nlohmann::json::parse(body);
+	auto parsed = parseBody(req, body);
+	if (!parsed) {
+		setContent(req, res, std::string("{\"Error\":\"Malformed body.\",\"ErrorNum\":400}"));
+		return;
+	}
+	auto& json = *parsed;
 	bool readState = false;
 	uint16_t nAdsState{};
 	uint16_t nDeviceState{};
@@ -699,13 +921,13 @@ int main(int argc, const char** argv)
 	if (json.contains("Ads")) {
 		if (!json["Ads"].is_number_unsigned()) {
 			strstream << "{\"Error\":\"adsState must be unsigned integer.\"}";
-			res.set_content(strstream.str(), "text/json");
+			setContent(req, res, strstream.str());
 			return;
 		}
 		nAdsState = json["Ads"].get<uint16_t>();
 		if (nAdsState >= ADSSTATE_MAXSTATES) {
 			strstream << "{\"Error\":\"Invalid ADSState.\"}";
-			res.set_content(strstream.str(), "text/json");
+			setContent(req, res, strstream.str());
 			return;
 		}
 	}
@@ -716,7 +938,7 @@ int main(int argc, const char** argv)
 	if (json.contains("Device")) {
 		if (!json["Device"].is_number_unsigned()) {
 			strstream << "{\"error\":\"deviceState must be unsigned integer.\"}";
-			res.set_content(strstream.str(), "text/json");
+			setContent(req, res, strstream.str());
 			return;
 		}
 		nDeviceState = json["Device"].get<uint16_t>();
@@ -730,10 +952,10 @@ int main(int argc, const char** argv)
 		strstream << "{\"Error\":\"ADS request unsuccessful.\",\"ErrorNum\":" << nErr << '}';
 	}
 	else {
-		strstream << body;
+		strstream << json.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
 	}
 
-	res.set_content(strstream.str(), "text/json");
+	setContent(req, res, strstream.str());
 		});
 
 	auto port = 1234;
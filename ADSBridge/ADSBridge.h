@@ -3,14 +3,18 @@
 
 #pragma once
 
+#include <deque>
 #include <iostream>
+#include <set>
 #include <thread>
-#include <conio.h>
 #include "include/httplib/httplib.h"
+#ifdef _WIN32
+#include <conio.h>
 #include <windows.h>
+#endif
 #include "include/nlohmann/json.hpp"
 
-#include "C:\TwinCAT\AdsApi\TcAdsDll\Include\TcAdsDef.h"
-#include "C:\TwinCAT\AdsApi\TcAdsDll\Include\TcAdsApi.h"
+#include "Compression.h"
+#include "TwinCat.h"
 
 // TODO: Reference additional headers your program requires here.
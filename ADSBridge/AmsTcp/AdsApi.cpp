@@ -0,0 +1,641 @@
+// AdsApi.cpp : Native AMS/TCP implementation of the ADS API.
+//
+#include "AdsApi.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+static_assert(std::endian::native == std::endian::little, "AMS/TCP frames are copied as little-endian structures");
+
+namespace {
+
+// ADS command ids
+constexpr USHORT ADSSRVID_READDEVICEINFO = 0x1;
+constexpr USHORT ADSSRVID_READ = 0x2;
+constexpr USHORT ADSSRVID_WRITE = 0x3;
+constexpr USHORT ADSSRVID_READSTATE = 0x4;
+constexpr USHORT ADSSRVID_WRITECTRL = 0x5;
+constexpr USHORT ADSSRVID_ADDDEVICENOTE = 0x6;
+constexpr USHORT ADSSRVID_DELDEVICENOTE = 0x7;
+constexpr USHORT ADSSRVID_DEVICENOTE = 0x8;
+constexpr USHORT ADSSRVID_READWRITE = 0x9;
+
+// AMS state flags of ADS requests and responses
+constexpr USHORT AMS_STATEFLAG_RESPONSE = 0x0001;
+constexpr USHORT AMS_STATEFLAG_ADSCMD = 0x0004;
+
+// First AMS port handed out by AdsPortOpen
+constexpr USHORT AMS_FIRST_PORT = 30000;
+
+// Interval in which the receive thread checks pending requests for expired timeouts
+constexpr std::chrono::milliseconds AMS_TIMEOUT_CHECK_INTERVAL{ 50 };
+
+#pragma pack(push, 1)
+// Prefix of every frame exchanged with the AMS router
+struct AmsTcpHeader {
+	USHORT reserved;
+	ULONG length;
+};
+
+// AMS header following the AMS/TCP header
+struct AmsHeader {
+	AmsNetId targetNetId;
+	USHORT targetPort;
+	AmsNetId sourceNetId;
+	USHORT sourcePort;
+	USHORT commandId;
+	USHORT stateFlags;
+	ULONG length;
+	ULONG errorCode;
+	ULONG invokeId;
+};
+#pragma pack(pop)
+
+// Largest frame accepted from the router: AMS header, ADS result and length and up to 64 MB of data.
+// A longer length comes from a corrupt or hostile stream, so the connection is dropped instead of allocating it.
+constexpr size_t AMS_MAX_FRAME_LENGTH = sizeof(AmsHeader) + 2 * sizeof(ULONG) + 64 * 1024 * 1024;
+
+// Appends raw bytes of value to frame
+void append(std::vector<char>& frame, const auto& value) {
+	const char* data = reinterpret_cast<const char*>(&value);
+	frame.insert(frame.end(), data, data + sizeof(value));
+}
+
+// Parses AMS net id in dotted notation (e.g. 192.168.0.10.1.1)
+std::optional<AmsNetId> parseNetId(const char* str) {
+	unsigned int b[6]{};
+	char tail{};
+	if (!str || sscanf(str, "%u.%u.%u.%u.%u.%u%c", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &tail) != 6) return std::nullopt;
+	AmsNetId netId{};
+	for (int i = 0; i < 6; i++) {
+		if (b[i] > 0xFF) return std::nullopt;
+		netId.b[i] = static_cast<UCHAR>(b[i]);
+	}
+	return netId;
+}
+
+// Returns AMS net id of IPv4 address (IPv4 address followed by .1.1)
+AmsNetId getNetId(const sockaddr_in& address) {
+	AmsNetId netId{ { 0, 0, 0, 0, 1, 1 } };
+	memcpy(netId.b, &address.sin_addr.s_addr, 4);
+	return netId;
+}
+
+// Resolves IPv4 address of host
+std::optional<sockaddr_in> resolve(const std::string& host, USHORT port) {
+	addrinfo hints{};
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* result = nullptr;
+	if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) || !result) return std::nullopt;
+	sockaddr_in address{};
+	memcpy(&address, result->ai_addr, sizeof(address));
+	freeaddrinfo(result);
+	return address;
+}
+
+// Sends all bytes, returns false if connection was lost
+bool sendAll(int sock, const std::vector<char>& frame) {
+	for (size_t sent = 0; sent < frame.size();) {
+		ssize_t n = send(sock, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+		if (n <= 0) return false;
+		sent += static_cast<size_t>(n);
+	}
+	return true;
+}
+
+// Receives exactly size bytes, returns false if connection was lost, idle is called whenever the receive timeout expires
+bool receiveAll(int sock, void* data, size_t size, const auto& idle) {
+	for (size_t received = 0; received < size;) {
+		ssize_t n = recv(sock, static_cast<char*>(data) + received, size - received, 0);
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+			idle();
+			continue;
+		}
+		if (n <= 0) return false;
+		received += static_cast<size_t>(n);
+	}
+	return true;
+}
+
+// Response of the ADS device to a single request (AMS error and ADS response data)
+struct AmsResponse {
+	long nErr;
+	std::vector<char> data;
+};
+
+// Callback registered for a device notification handle
+struct AmsNotification {
+	AmsAddr addr;
+	PAdsNotificationFuncEx callback;
+	ULONG hUser;
+};
+
+// Called with the response of a request on the receive thread or with an error if the request failed
+typedef std::function<void(AmsResponse)> AmsCompletion;
+
+// Request waiting for its response, notification callbacks are registered by the receive thread
+// before any following frame is dispatched so that the first sample is never lost
+struct AmsPendingRequest {
+	AmsCompletion complete;
+	std::optional<AmsNotification> notification;
+	std::chrono::steady_clock::time_point deadline;
+};
+
+// Single AMS/TCP connection shared by all callers, responses are matched to requests by invoke id
+// so any number of requests of any number of threads may be in flight at the same time.
+// Completions and notification callbacks are called on the receive thread and must not wait for ADS requests themselves.
+class AmsTcpConnection {
+public:
+	~AmsTcpConnection() {
+		close();
+	}
+
+	long setRouter(const char* routerHost, USHORT port, const AmsNetId* pNetId, const AmsNetId* pLocalNetId) {
+		std::lock_guard<std::mutex> lock(mutex);
+		host = routerHost ? routerHost : "127.0.0.1";
+		routerPort = port ? port : ADS_TCP_SERVER_PORT;
+		netId = pNetId ? std::optional<AmsNetId>(*pNetId) : std::nullopt;
+		localNetId = pLocalNetId ? std::optional<AmsNetId>(*pLocalNetId) : std::nullopt;
+		configured = true;
+		return ADSERR_NOERR;
+	}
+
+	// Opens AMS port, connection to the router is established lazily and re-established after it was lost
+	long open() {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (localPort) return localPort;
+		if (!configured) {
+			const char* envHost = getenv("ADS_ROUTER_HOST");
+			const char* envPort = getenv("ADS_ROUTER_PORT");
+			host = envHost ? envHost : "127.0.0.1";
+			routerPort = envPort ? static_cast<USHORT>(atoi(envPort)) : ADS_TCP_SERVER_PORT;
+			netId = parseNetId(getenv("ADS_NETID"));
+			localNetId = parseNetId(getenv("ADS_LOCAL_NETID"));
+		}
+		auto address = resolve(host, routerPort);
+		targetNetId = netId ? *netId : address ? getNetId(*address) : AmsNetId{};
+		localPort = nextPort++;
+		connect();
+		return localPort;
+	}
+
+	long close() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!localPort) return ADSERR_CLIENT_PORTNOTOPEN;
+			localPort = 0;
+			if (sock >= 0) shutdown(sock, SHUT_RDWR);
+		}
+		// No reconnect can happen while the port is closed, so the receive thread can be joined without holding the lock
+		if (receiver.joinable() && receiver.get_id() != std::this_thread::get_id()) receiver.join();
+		std::lock_guard<std::mutex> lock(mutex);
+		std::lock_guard<std::mutex> sendLock(sendMutex);
+		if (sock >= 0) ::close(sock);
+		sock = -1;
+		connected = false;
+		notifications.clear();
+		return ADSERR_NOERR;
+	}
+
+	long getLocalAddress(PAmsAddr pAddr) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!localPort) return ADSERR_CLIENT_PORTNOTOPEN;
+		pAddr->netId = targetNetId;
+		pAddr->port = localPort;
+		return ADSERR_NOERR;
+	}
+
+	long setTimeout(LONG nMs) {
+		if (nMs <= 0) return ADSERR_CLIENT_TIMEOUTINVALID;
+		std::lock_guard<std::mutex> lock(mutex);
+		timeout = std::chrono::milliseconds(nMs);
+		return ADSERR_NOERR;
+	}
+
+	// Sends ADS request, complete is called once with the response, a timeout or a lost connection
+	void send(const AmsAddr& target, USHORT commandId, const std::vector<char>& payload, AmsCompletion complete, std::optional<AmsNotification> notification = std::nullopt) {
+		std::vector<char> frame{};
+		ULONG invokeId{};
+		int requestSock = -1;
+		long nErr = ADSERR_NOERR;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			nErr = localPort ? connect() : ADSERR_CLIENT_PORTNOTOPEN;
+			if (!nErr) {
+				invokeId = nextInvokeId++;
+				pending[invokeId] = AmsPendingRequest{ complete, notification, std::chrono::steady_clock::now() + timeout };
+				append(frame, AmsTcpHeader{ 0, static_cast<ULONG>(sizeof(AmsHeader) + payload.size()) });
+				append(frame, AmsHeader{ target.netId, target.port, sourceNetId, localPort, commandId, AMS_STATEFLAG_ADSCMD, static_cast<ULONG>(payload.size()), 0, invokeId });
+				frame.insert(frame.end(), payload.begin(), payload.end());
+				requestSock = sock;
+			}
+		}
+		if (nErr) {
+			complete(AmsResponse{ nErr, {} });
+			return;
+		}
+		// A failed send shuts the connection down, the receive thread then fails all pending requests
+		std::lock_guard<std::mutex> sendLock(sendMutex);
+		if (!sendAll(requestSock, frame)) shutdown(requestSock, SHUT_RDWR);
+	}
+
+	// Sends ADS request and waits for its response, response data excludes the ADS result code
+	long request(const AmsAddr& target, USHORT commandId, const std::vector<char>& payload, std::vector<char>& response, std::optional<AmsNotification> notification = std::nullopt) {
+		auto promise = std::make_shared<std::promise<AmsResponse>>();
+		std::future<AmsResponse> future = promise->get_future();
+		send(target, commandId, payload, [promise](AmsResponse result) { promise->set_value(std::move(result)); }, notification);
+		return getResult(future.get(), response);
+	}
+
+	// Splits response into ADS result code and response data
+	static long getResult(AmsResponse result, std::vector<char>& response) {
+		if (result.nErr) return result.nErr;
+		if (result.data.size() < sizeof(ULONG)) return ADSERR_CLIENT_SYNCRESINVALID;
+		ULONG nResult{};
+		memcpy(&nResult, result.data.data(), sizeof(nResult));
+		if (nResult) return static_cast<long>(nResult);
+		response.assign(result.data.begin() + sizeof(ULONG), result.data.end());
+		return ADSERR_NOERR;
+	}
+
+	void removeNotification(ULONG hNotification) {
+		std::lock_guard<std::mutex> lock(mutex);
+		notifications.erase(hNotification);
+	}
+
+private:
+	// Connects to the router unless connected, requires lock
+	long connect() {
+		if (connected) return ADSERR_NOERR;
+		// Receive thread of a lost connection has already left its locked section once connected is false
+		if (receiver.joinable()) receiver.join();
+		{
+			std::lock_guard<std::mutex> sendLock(sendMutex);
+			if (sock >= 0) ::close(sock);
+			sock = -1;
+		}
+		auto address = resolve(host, routerPort);
+		if (!address) return ADSERR_CLIENT_NOAMSADDR;
+		int newSock = socket(AF_INET, SOCK_STREAM, 0);
+		if (newSock < 0) return ADSERR_CLIENT_W32ERROR;
+		if (::connect(newSock, reinterpret_cast<const sockaddr*>(&*address), sizeof(*address))) {
+			::close(newSock);
+			return ADSERR_CLIENT_W32ERROR;
+		}
+		int noDelay = 1;
+		setsockopt(newSock, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+		timeval interval{ 0, static_cast<suseconds_t>(std::chrono::microseconds(AMS_TIMEOUT_CHECK_INTERVAL).count()) };
+		setsockopt(newSock, SOL_SOCKET, SO_RCVTIMEO, &interval, sizeof(interval));
+		sockaddr_in local{};
+		socklen_t localLength = sizeof(local);
+		getsockname(newSock, reinterpret_cast<sockaddr*>(&local), &localLength);
+		sourceNetId = localNetId ? *localNetId : getNetId(local);
+		sock = newSock;
+		connected = true;
+		receiver = std::thread(&AmsTcpConnection::receive, this, newSock);
+		return ADSERR_NOERR;
+	}
+
+	// Receive thread, dispatches responses and device notifications until the connection is lost
+	void receive(int receiveSock) {
+		std::vector<char> frame{};
+		// Timeouts are checked whenever the receive timeout expires and, since a steady stream of frames (e.g. notifications)
+		// never lets it expire, after received frames at most once per check interval
+		auto checked = std::chrono::steady_clock::now();
+		auto idle = [this, &checked]() {
+			checked = std::chrono::steady_clock::now();
+			expire();
+		};
+		for (;;) {
+			AmsTcpHeader tcpHeader{};
+			if (!receiveAll(receiveSock, &tcpHeader, sizeof(tcpHeader), idle)) break;
+			if (tcpHeader.length > AMS_MAX_FRAME_LENGTH) break;
+			frame.resize(tcpHeader.length);
+			if (!receiveAll(receiveSock, frame.data(), frame.size(), idle)) break;
+			if (std::chrono::steady_clock::now() - checked >= AMS_TIMEOUT_CHECK_INTERVAL) idle();
+			// Router commands (e.g. port registration) carry a non-zero reserved field and are ignored
+			if (tcpHeader.reserved || frame.size() < sizeof(AmsHeader)) continue;
+			AmsHeader header{};
+			memcpy(&header, frame.data(), sizeof(header));
+			const char* data = frame.data() + sizeof(header);
+			size_t size = std::min<size_t>(header.length, frame.size() - sizeof(header));
+			if (header.stateFlags & AMS_STATEFLAG_RESPONSE) {
+				complete(header, data, size);
+			}
+			else if (header.commandId == ADSSRVID_DEVICENOTE) {
+				notify(data, size);
+			}
+		}
+		std::map<ULONG, AmsPendingRequest> failed{};
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (sock == receiveSock) connected = false;
+			// Device notifications do not survive the connection
+			notifications.clear();
+			failed.swap(pending);
+		}
+		for (auto& [invokeId, pendingRequest] : failed) {
+			pendingRequest.complete(AmsResponse{ ADSERR_CLIENT_W32ERROR, {} });
+		}
+	}
+
+	// Fails pending requests whose timeout expired
+	void expire() {
+		std::vector<AmsCompletion> expired{};
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto now = std::chrono::steady_clock::now();
+			for (auto it = pending.begin(); it != pending.end();) {
+				if (it->second.deadline > now) {
+					it++;
+					continue;
+				}
+				expired.push_back(std::move(it->second.complete));
+				it = pending.erase(it);
+			}
+		}
+		for (AmsCompletion& complete : expired) {
+			complete(AmsResponse{ ADSERR_CLIENT_SYNCTIMEOUT, {} });
+		}
+	}
+
+	void complete(const AmsHeader& header, const char* data, size_t size) {
+		AmsCompletion response{};
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = pending.find(header.invokeId);
+			if (it == pending.end()) return;
+			// Response of AdsSyncAddDeviceNotificationReq: result followed by notification handle
+			ULONG result[2]{};
+			if (it->second.notification && !header.errorCode && size >= sizeof(result)) {
+				memcpy(result, data, sizeof(result));
+				if (!result[0]) notifications[result[1]] = *it->second.notification;
+			}
+			response = std::move(it->second.complete);
+			pending.erase(it);
+		}
+		response(AmsResponse{ static_cast<long>(header.errorCode), std::vector<char>(data, data + size) });
+	}
+
+	// Notification stream: length and number of stamps followed by stamps (timestamp, number of samples, samples)
+	// where every sample consists of notification handle, sample size and data
+	void notify(const char* data, size_t size) {
+		ULONG stamps{};
+		if (size < 2 * sizeof(ULONG)) return;
+		memcpy(&stamps, data + sizeof(ULONG), sizeof(stamps));
+		size_t pos = 2 * sizeof(ULONG);
+		std::vector<char> buffer{};
+		for (ULONG stamp = 0; stamp < stamps && pos + sizeof(int64_t) + sizeof(ULONG) <= size; stamp++) {
+			int64_t timestamp{};
+			ULONG samples{};
+			memcpy(&timestamp, data + pos, sizeof(timestamp));
+			memcpy(&samples, data + pos + sizeof(timestamp), sizeof(samples));
+			pos += sizeof(timestamp) + sizeof(samples);
+			for (ULONG sample = 0; sample < samples && pos + 2 * sizeof(ULONG) <= size; sample++) {
+				ULONG hNotification{};
+				ULONG sampleSize{};
+				memcpy(&hNotification, data + pos, sizeof(hNotification));
+				memcpy(&sampleSize, data + pos + sizeof(ULONG), sizeof(sampleSize));
+				pos += 2 * sizeof(ULONG);
+				if (pos + sampleSize > size) return;
+				std::optional<AmsNotification> notification{};
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					auto it = notifications.find(hNotification);
+					if (it != notifications.end()) notification = it->second;
+				}
+				if (notification) {
+					buffer.assign(std::max(sizeof(AdsNotificationHeader), offsetof(AdsNotificationHeader, data) + sampleSize), 0);
+					auto* pNotification = reinterpret_cast<AdsNotificationHeader*>(buffer.data());
+					pNotification->nTimeStamp = timestamp;
+					pNotification->hNotification = hNotification;
+					pNotification->cbSampleSize = sampleSize;
+					memcpy(pNotification->data, data + pos, sampleSize);
+					notification->callback(&notification->addr, pNotification, notification->hUser);
+				}
+				pos += sampleSize;
+			}
+		}
+	}
+
+	std::mutex mutex;
+	// Serializes writes of whole frames to the socket
+	std::mutex sendMutex;
+	bool configured = false;
+	std::string host{};
+	USHORT routerPort = ADS_TCP_SERVER_PORT;
+	std::optional<AmsNetId> netId{};
+	std::optional<AmsNetId> localNetId{};
+	AmsNetId targetNetId{};
+	AmsNetId sourceNetId{};
+	USHORT localPort = 0;
+	USHORT nextPort = AMS_FIRST_PORT;
+	int sock = -1;
+	bool connected = false;
+	std::thread receiver{};
+	std::map<ULONG, AmsPendingRequest> pending{};
+	std::map<ULONG, AmsNotification> notifications{};
+	ULONG nextInvokeId = 1;
+	std::chrono::milliseconds timeout{ 5000 };
+};
+
+AmsTcpConnection& getConnection() {
+	static AmsTcpConnection connection{};
+	return connection;
+}
+
+// Returns payload of read (write data is empty) or write request
+std::vector<char> getPayload(ULONG nIndexGroup, ULONG nIndexOffset, ULONG nLength, const void* pData) {
+	std::vector<char> payload{};
+	append(payload, nIndexGroup);
+	append(payload, nIndexOffset);
+	append(payload, nLength);
+	if (pData) payload.insert(payload.end(), static_cast<const char*>(pData), static_cast<const char*>(pData) + nLength);
+	return payload;
+}
+
+// Sends request and completes future with ADS result and, for read and read-write requests, the returned data (following its length)
+std::future<AdsAsyncResult> sendAsync(PAmsAddr pAddr, USHORT commandId, const std::vector<char>& payload, ULONG nReadLength) {
+	auto promise = std::make_shared<std::promise<AdsAsyncResult>>();
+	std::future<AdsAsyncResult> future = promise->get_future();
+	if (!pAddr) {
+		promise->set_value(AdsAsyncResult{ ADSERR_CLIENT_NOAMSADDR, {} });
+		return future;
+	}
+	bool hasData = commandId != ADSSRVID_WRITE;
+	getConnection().send(*pAddr, commandId, payload, [promise, hasData, nReadLength](AmsResponse response) {
+		AdsAsyncResult result{};
+		std::vector<char> data{};
+		result.nErr = AmsTcpConnection::getResult(std::move(response), data);
+		ULONG length{};
+		if (!result.nErr && hasData && data.size() < sizeof(length)) result.nErr = ADSERR_CLIENT_SYNCRESINVALID;
+		if (!result.nErr && hasData) {
+			memcpy(&length, data.data(), sizeof(length));
+			length = std::min({ length, nReadLength, static_cast<ULONG>(data.size() - sizeof(length)) });
+			result.data.assign(data.begin() + sizeof(length), data.begin() + sizeof(length) + length);
+		}
+		promise->set_value(std::move(result));
+	});
+	return future;
+}
+
+// Waits for asynchronous read and copies its data to caller's buffer
+long readAsyncResult(std::future<AdsAsyncResult> future, void* pData, ULONG* pnRead) {
+	AdsAsyncResult result = future.get();
+	if (result.nErr) return result.nErr;
+	if (!result.data.empty()) memcpy(pData, result.data.data(), result.data.size());
+	if (pnRead) *pnRead = static_cast<ULONG>(result.data.size());
+	return ADSERR_NOERR;
+}
+
+}
+
+long AdsGetDllVersion(void) {
+	AdsVersion version{ 1, 0, 0 };
+	long nVersion = 0;
+	memcpy(&nVersion, &version, sizeof(version));
+	return nVersion;
+}
+
+long AdsPortOpen(void) {
+	return getConnection().open();
+}
+
+long AdsPortClose(void) {
+	return getConnection().close();
+}
+
+long AdsGetLocalAddress(PAmsAddr pAddr) {
+	if (!pAddr) return ADSERR_CLIENT_NOAMSADDR;
+	return getConnection().getLocalAddress(pAddr);
+}
+
+long AdsSyncWriteReq(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nLength, void* pData) {
+	return AdsAsyncWriteReq(pAddr, nIndexGroup, nIndexOffset, nLength, pData).get().nErr;
+}
+
+long AdsSyncReadReq(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nLength, void* pData) {
+	return AdsSyncReadReqEx(pAddr, nIndexGroup, nIndexOffset, nLength, pData, nullptr);
+}
+
+long AdsSyncReadReqEx(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nLength, void* pData, ULONG* pnRead) {
+	return readAsyncResult(AdsAsyncReadReq(pAddr, nIndexGroup, nIndexOffset, nLength), pData, pnRead);
+}
+
+long AdsSyncReadWriteReq(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nReadLength, void* pReadData, ULONG nWriteLength, void* pWriteData) {
+	return AdsSyncReadWriteReqEx(pAddr, nIndexGroup, nIndexOffset, nReadLength, pReadData, nWriteLength, pWriteData, nullptr);
+}
+
+long AdsSyncReadWriteReqEx(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nReadLength, void* pReadData, ULONG nWriteLength, void* pWriteData, ULONG* pnRead) {
+	return readAsyncResult(AdsAsyncReadWriteReq(pAddr, nIndexGroup, nIndexOffset, nReadLength, nWriteLength, pWriteData), pReadData, pnRead);
+}
+
+std::future<AdsAsyncResult> AdsAsyncReadReq(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nLength) {
+	return sendAsync(pAddr, ADSSRVID_READ, getPayload(nIndexGroup, nIndexOffset, nLength, nullptr), nLength);
+}
+
+std::future<AdsAsyncResult> AdsAsyncWriteReq(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nLength, const void* pData) {
+	return sendAsync(pAddr, ADSSRVID_WRITE, getPayload(nIndexGroup, nIndexOffset, nLength, pData), 0);
+}
+
+std::future<AdsAsyncResult> AdsAsyncReadWriteReq(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nReadLength, ULONG nWriteLength, const void* pWriteData) {
+	std::vector<char> payload{};
+	append(payload, nIndexGroup);
+	append(payload, nIndexOffset);
+	append(payload, nReadLength);
+	append(payload, nWriteLength);
+	if (nWriteLength) payload.insert(payload.end(), static_cast<const char*>(pWriteData), static_cast<const char*>(pWriteData) + nWriteLength);
+	return sendAsync(pAddr, ADSSRVID_READWRITE, payload, nReadLength);
+}
+
+long AdsSyncReadDeviceInfoReq(PAmsAddr pAddr, char* pDevName, PAdsVersion pVersion) {
+	if (!pAddr) return ADSERR_CLIENT_NOAMSADDR;
+	std::vector<char> response{};
+	if (long nErr = getConnection().request(*pAddr, ADSSRVID_READDEVICEINFO, {}, response)) return nErr;
+	// Version followed by device name with fixed length of 16 bytes
+	constexpr size_t nameLength = 16;
+	if (response.size() < sizeof(AdsVersion) + nameLength) return ADSERR_CLIENT_SYNCRESINVALID;
+	if (pVersion) memcpy(pVersion, response.data(), sizeof(AdsVersion));
+	if (pDevName) memcpy(pDevName, response.data() + sizeof(AdsVersion), nameLength);
+	return ADSERR_NOERR;
+}
+
+long AdsSyncWriteControlReq(PAmsAddr pAddr, USHORT nAdsState, USHORT nDeviceState, ULONG nLength, void* pData) {
+	if (!pAddr) return ADSERR_CLIENT_NOAMSADDR;
+	std::vector<char> payload{};
+	append(payload, nAdsState);
+	append(payload, nDeviceState);
+	append(payload, nLength);
+	if (nLength) payload.insert(payload.end(), static_cast<const char*>(pData), static_cast<const char*>(pData) + nLength);
+	std::vector<char> response{};
+	return getConnection().request(*pAddr, ADSSRVID_WRITECTRL, payload, response);
+}
+
+long AdsSyncReadStateReq(PAmsAddr pAddr, USHORT* pAdsState, USHORT* pDeviceState) {
+	if (!pAddr) return ADSERR_CLIENT_NOAMSADDR;
+	std::vector<char> response{};
+	if (long nErr = getConnection().request(*pAddr, ADSSRVID_READSTATE, {}, response)) return nErr;
+	if (response.size() < 2 * sizeof(USHORT)) return ADSERR_CLIENT_SYNCRESINVALID;
+	if (pAdsState) memcpy(pAdsState, response.data(), sizeof(USHORT));
+	if (pDeviceState) memcpy(pDeviceState, response.data() + sizeof(USHORT), sizeof(USHORT));
+	return ADSERR_NOERR;
+}
+
+long AdsSyncAddDeviceNotificationReq(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, PAdsNotificationAttrib pNoteAttrib, PAdsNotificationFuncEx pNoteFunc, ULONG hUser, ULONG* pNotification) {
+	if (!pAddr) return ADSERR_CLIENT_NOAMSADDR;
+	if (!pNoteAttrib || !pNoteFunc || !pNotification) return ADSERR_CLIENT_INVALIDPARM;
+	std::vector<char> payload{};
+	append(payload, nIndexGroup);
+	append(payload, nIndexOffset);
+	append(payload, pNoteAttrib->cbLength);
+	append(payload, static_cast<ULONG>(pNoteAttrib->nTransMode));
+	append(payload, pNoteAttrib->nMaxDelay);
+	append(payload, pNoteAttrib->nCycleTime);
+	payload.resize(payload.size() + 16);
+	std::vector<char> response{};
+	if (long nErr = getConnection().request(*pAddr, ADSSRVID_ADDDEVICENOTE, payload, response, AmsNotification{ *pAddr, pNoteFunc, hUser })) return nErr;
+	if (response.size() < sizeof(ULONG)) return ADSERR_CLIENT_SYNCRESINVALID;
+	memcpy(pNotification, response.data(), sizeof(ULONG));
+	return ADSERR_NOERR;
+}
+
+long AdsSyncDelDeviceNotificationReq(PAmsAddr pAddr, ULONG hNotification) {
+	if (!pAddr) return ADSERR_CLIENT_NOAMSADDR;
+	// Callback is unregistered first so that no sample is delivered once this returns
+	getConnection().removeNotification(hNotification);
+	std::vector<char> payload{};
+	append(payload, hNotification);
+	std::vector<char> response{};
+	return getConnection().request(*pAddr, ADSSRVID_DELDEVICENOTE, payload, response);
+}
+
+long AdsSyncSetTimeout(LONG nMs) {
+	return getConnection().setTimeout(nMs);
+}
+
+long AmsTcpSetRouter(const char* host, USHORT port, const AmsNetId* pNetId, const AmsNetId* pLocalNetId) {
+	return getConnection().setRouter(host, port, pNetId, pLocalNetId);
+}
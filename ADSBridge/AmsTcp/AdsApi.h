@@ -0,0 +1,42 @@
+// AdsApi.h : ADS API of the native AMS/TCP backend.
+// Provides the AdsSync* functions of TcAdsApi.h by talking to an AMS router on TCP port 48898 directly.
+
+#pragma once
+
+#include <future>
+#include <vector>
+
+#include "AdsDef.h"
+
+long AdsGetDllVersion(void);
+long AdsPortOpen(void);
+long AdsPortClose(void);
+// Returns AMS net id of the connected router, the port is set to the port returned by AdsPortOpen
+long AdsGetLocalAddress(PAmsAddr pAddr);
+long AdsSyncWriteReq(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nLength, void* pData);
+long AdsSyncReadReq(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nLength, void* pData);
+long AdsSyncReadReqEx(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nLength, void* pData, ULONG* pnRead);
+long AdsSyncReadWriteReq(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nReadLength, void* pReadData, ULONG nWriteLength, void* pWriteData);
+long AdsSyncReadWriteReqEx(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nReadLength, void* pReadData, ULONG nWriteLength, void* pWriteData, ULONG* pnRead);
+long AdsSyncReadDeviceInfoReq(PAmsAddr pAddr, char* pDevName, PAdsVersion pVersion);
+long AdsSyncWriteControlReq(PAmsAddr pAddr, USHORT nAdsState, USHORT nDeviceState, ULONG nLength, void* pData);
+long AdsSyncReadStateReq(PAmsAddr pAddr, USHORT* pAdsState, USHORT* pDeviceState);
+long AdsSyncAddDeviceNotificationReq(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, PAdsNotificationAttrib pNoteAttrib, PAdsNotificationFuncEx pNoteFunc, ULONG hUser, ULONG* pNotification);
+long AdsSyncDelDeviceNotificationReq(PAmsAddr pAddr, ULONG hNotification);
+long AdsSyncSetTimeout(LONG nMs);
+
+// Result of an asynchronous request, data holds the bytes returned by read and read-write requests
+struct AdsAsyncResult {
+	long nErr;
+	std::vector<char> data;
+};
+
+// Asynchronous requests are sent before returning and complete their future once the response arrives (or the timeout expires),
+// any number of them may be in flight on the connection at the same time. Write data is copied before returning.
+std::future<AdsAsyncResult> AdsAsyncReadReq(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nLength);
+std::future<AdsAsyncResult> AdsAsyncWriteReq(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nLength, const void* pData);
+std::future<AdsAsyncResult> AdsAsyncReadWriteReq(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nReadLength, ULONG nWriteLength, const void* pWriteData);
+
+// Sets AMS router used by the next AdsPortOpen, host and port default to ADS_ROUTER_HOST/ADS_ROUTER_PORT (127.0.0.1:48898)
+// Net ids default to ADS_NETID/ADS_LOCAL_NETID, otherwise to the IPv4 address of the router/local socket followed by .1.1
+long AmsTcpSetRouter(const char* host, USHORT port, const AmsNetId* pNetId = nullptr, const AmsNetId* pLocalNetId = nullptr);
@@ -0,0 +1,291 @@
+// AdsDef.h : ADS type, constant and structure definitions of the native AMS/TCP backend.
+// Mirrors the names of TcAdsDef.h so that the bridge compiles unchanged without TwinCAT.
+
+#pragma once
+
+#include <cstdint>
+
+typedef uint8_t UCHAR;
+typedef uint16_t USHORT;
+typedef uint32_t ULONG;
+typedef int32_t LONG;
+typedef unsigned int UINT;
+typedef int BOOL;
+typedef char* PCHAR;
+typedef int8_t INT8;
+typedef int16_t INT16;
+typedef int32_t INT32;
+typedef int64_t INT64;
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+
+typedef int8_t ADS_INT8;
+typedef uint8_t ADS_UINT8;
+typedef int16_t ADS_INT16;
+typedef uint16_t ADS_UINT16;
+typedef int32_t ADS_INT32;
+typedef uint32_t ADS_UINT32;
+typedef int64_t ADS_INT64;
+typedef uint64_t ADS_UINT64;
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef __stdcall
+#define __stdcall
+#endif
+#define ANYSIZE_ARRAY 1
+
+// TCP port of the AMS router
+#define ADS_TCP_SERVER_PORT 48898
+
+#define ADSIGRP_SYMTAB 0xF000
+#define ADSIGRP_SYMNAME 0xF001
+#define ADSIGRP_SYMVAL 0xF002
+#define ADSIGRP_SYM_HNDBYNAME 0xF003
+#define ADSIGRP_SYM_VALBYNAME 0xF004
+#define ADSIGRP_SYM_VALBYHND 0xF005
+#define ADSIGRP_SYM_RELEASEHND 0xF006
+#define ADSIGRP_SYM_INFOBYNAME 0xF007
+#define ADSIGRP_SYM_VERSION 0xF008
+#define ADSIGRP_SYM_INFOBYNAMEEX 0xF009
+#define ADSIGRP_SYM_DOWNLOAD 0xF00A
+#define ADSIGRP_SYM_UPLOAD 0xF00B
+#define ADSIGRP_SYM_UPLOADINFO 0xF00C
+#define ADSIGRP_SYM_DT_UPLOAD 0xF00E
+#define ADSIGRP_SYM_UPLOADINFO2 0xF00F
+#define ADSIGRP_SYMNOTE 0xF010
+#define ADSIGRP_IOIMAGE_RWIB 0xF020
+#define ADSIGRP_IOIMAGE_RWIX 0xF021
+#define ADSIGRP_IOIMAGE_RWOB 0xF030
+#define ADSIGRP_IOIMAGE_RWOX 0xF031
+#define ADSIGRP_SUMUP_READ 0xF080
+#define ADSIGRP_SUMUP_WRITE 0xF081
+#define ADSIGRP_SUMUP_READWRITE 0xF082
+#define ADSIGRP_SUMUP_READEX 0xF083
+#define ADSIGRP_SUMUP_READEX2 0xF084
+#define ADSIGRP_SUMUP_ADDDEVNOTE 0xF085
+#define ADSIGRP_SUMUP_DELDEVNOTE 0xF086
+#define ADSIGRP_DEVICE_DATA 0xF100
+
+#define ERR_ADSERRS 0x0700
+#define ADSERR_NOERR 0x00
+#define ADSERR_DEVICE_ERROR (0x00 + ERR_ADSERRS)
+#define ADSERR_DEVICE_SRVNOTSUPP (0x01 + ERR_ADSERRS)
+#define ADSERR_DEVICE_INVALIDGRP (0x02 + ERR_ADSERRS)
+#define ADSERR_DEVICE_INVALIDOFFSET (0x03 + ERR_ADSERRS)
+#define ADSERR_DEVICE_INVALIDACCESS (0x04 + ERR_ADSERRS)
+#define ADSERR_DEVICE_INVALIDSIZE (0x05 + ERR_ADSERRS)
+#define ADSERR_DEVICE_INVALIDDATA (0x06 + ERR_ADSERRS)
+#define ADSERR_DEVICE_NOTREADY (0x07 + ERR_ADSERRS)
+#define ADSERR_DEVICE_BUSY (0x08 + ERR_ADSERRS)
+#define ADSERR_DEVICE_INVALIDCONTEXT (0x09 + ERR_ADSERRS)
+#define ADSERR_DEVICE_NOMEMORY (0x0A + ERR_ADSERRS)
+#define ADSERR_DEVICE_INVALIDPARM (0x0B + ERR_ADSERRS)
+#define ADSERR_DEVICE_NOTFOUND (0x0C + ERR_ADSERRS)
+#define ADSERR_DEVICE_SYNTAX (0x0D + ERR_ADSERRS)
+#define ADSERR_DEVICE_INCOMPATIBLE (0x0E + ERR_ADSERRS)
+#define ADSERR_DEVICE_EXISTS (0x0F + ERR_ADSERRS)
+#define ADSERR_DEVICE_SYMBOLNOTFOUND (0x10 + ERR_ADSERRS)
+#define ADSERR_DEVICE_SYMBOLVERSIONINVALID (0x11 + ERR_ADSERRS)
+#define ADSERR_DEVICE_INVALIDSTATE (0x12 + ERR_ADSERRS)
+#define ADSERR_DEVICE_TRANSMODENOTSUPP (0x13 + ERR_ADSERRS)
+#define ADSERR_DEVICE_NOTIFYHNDINVALID (0x14 + ERR_ADSERRS)
+#define ADSERR_DEVICE_CLIENTUNKNOWN (0x15 + ERR_ADSERRS)
+#define ADSERR_DEVICE_NOMOREHDLS (0x16 + ERR_ADSERRS)
+#define ADSERR_DEVICE_INVALIDWATCHSIZE (0x17 + ERR_ADSERRS)
+#define ADSERR_DEVICE_NOTINIT (0x18 + ERR_ADSERRS)
+#define ADSERR_DEVICE_TIMEOUT (0x19 + ERR_ADSERRS)
+#define ADSERR_DEVICE_NOINTERFACE (0x1A + ERR_ADSERRS)
+#define ADSERR_DEVICE_INVALIDINTERFACE (0x1B + ERR_ADSERRS)
+#define ADSERR_DEVICE_INVALIDCLSID (0x1C + ERR_ADSERRS)
+#define ADSERR_DEVICE_INVALIDOBJID (0x1D + ERR_ADSERRS)
+#define ADSERR_DEVICE_PENDING (0x1E + ERR_ADSERRS)
+#define ADSERR_DEVICE_ABORTED (0x1F + ERR_ADSERRS)
+#define ADSERR_DEVICE_WARNING (0x20 + ERR_ADSERRS)
+#define ADSERR_DEVICE_INVALIDARRAYIDX (0x21 + ERR_ADSERRS)
+#define ADSERR_DEVICE_SYMBOLNOTACTIVE (0x22 + ERR_ADSERRS)
+#define ADSERR_DEVICE_ACCESSDENIED (0x23 + ERR_ADSERRS)
+#define ADSERR_CLIENT_ERROR (0x40 + ERR_ADSERRS)
+#define ADSERR_CLIENT_INVALIDPARM (0x41 + ERR_ADSERRS)
+#define ADSERR_CLIENT_LISTEMPTY (0x42 + ERR_ADSERRS)
+#define ADSERR_CLIENT_VARUSED (0x43 + ERR_ADSERRS)
+#define ADSERR_CLIENT_DUPLINVOKEID (0x44 + ERR_ADSERRS)
+#define ADSERR_CLIENT_SYNCTIMEOUT (0x45 + ERR_ADSERRS)
+#define ADSERR_CLIENT_W32ERROR (0x46 + ERR_ADSERRS)
+#define ADSERR_CLIENT_TIMEOUTINVALID (0x47 + ERR_ADSERRS)
+#define ADSERR_CLIENT_PORTNOTOPEN (0x48 + ERR_ADSERRS)
+#define ADSERR_CLIENT_NOAMSADDR (0x49 + ERR_ADSERRS)
+#define ADSERR_CLIENT_SYNCINTERNAL (0x50 + ERR_ADSERRS)
+#define ADSERR_CLIENT_ADDHASH (0x51 + ERR_ADSERRS)
+#define ADSERR_CLIENT_REMOVEHASH (0x52 + ERR_ADSERRS)
+#define ADSERR_CLIENT_NOMORESYM (0x53 + ERR_ADSERRS)
+#define ADSERR_CLIENT_SYNCRESINVALID (0x54 + ERR_ADSERRS)
+
+typedef enum nAdsTransMode {
+	ADSTRANS_NOTRANS = 0,
+	ADSTRANS_CLIENTCYCLE = 1,
+	ADSTRANS_CLIENTONCHA = 2,
+	ADSTRANS_SERVERCYCLE = 3,
+	ADSTRANS_SERVERONCHA = 4,
+	ADSTRANS_SERVERCYCLE2 = 5,
+	ADSTRANS_SERVERONCHA2 = 6,
+	ADSTRANS_CLIENT1REQ = 10,
+	ADSTRANS_MAXMODES
+} ADSTRANSMODE;
+
+typedef enum nAdsState {
+	ADSSTATE_INVALID = 0,
+	ADSSTATE_IDLE = 1,
+	ADSSTATE_RESET = 2,
+	ADSSTATE_INIT = 3,
+	ADSSTATE_START = 4,
+	ADSSTATE_RUN = 5,
+	ADSSTATE_STOP = 6,
+	ADSSTATE_SAVECFG = 7,
+	ADSSTATE_LOADCFG = 8,
+	ADSSTATE_POWERFAILURE = 9,
+	ADSSTATE_POWERGOOD = 10,
+	ADSSTATE_ERROR = 11,
+	ADSSTATE_SHUTDOWN = 12,
+	ADSSTATE_SUSPEND = 13,
+	ADSSTATE_RESUME = 14,
+	ADSSTATE_CONFIG = 15,
+	ADSSTATE_RECONFIG = 16,
+	ADSSTATE_MAXSTATES
+} ADSSTATE;
+
+#define ADSDATATYPEFLAG_DATATYPE 0x00000001
+#define ADSDATATYPEFLAG_DATAITEM 0x00000002
+#define ADSDATATYPEFLAG_REFERENCETO 0x00000004
+#define ADSDATATYPEFLAG_METHODDEREF 0x00000008
+#define ADSDATATYPEFLAG_OVERSAMPLE 0x00000010
+#define ADSDATATYPEFLAG_BITVALUES 0x00000020
+#define ADSDATATYPEFLAG_PROPITEM 0x00000040
+#define ADSDATATYPEFLAG_TYPEGUID 0x00000080
+#define ADSDATATYPEFLAG_PERSISTENT 0x00000100
+#define ADSDATATYPEFLAG_COPYMASK 0x00000200
+#define ADSDATATYPEFLAG_TCCOMINTERFACEPTR 0x00000400
+#define ADSDATATYPEFLAG_METHODINFOS 0x00000800
+#define ADSDATATYPEFLAG_ATTRIBUTES 0x00001000
+#define ADSDATATYPEFLAG_ENUMINFOS 0x00002000
+
+#pragma pack(push, 1)
+
+typedef struct AmsNetId_ {
+	UCHAR b[6];
+} AmsNetId, *PAmsNetId;
+
+typedef struct AmsAddr_ {
+	AmsNetId netId;
+	USHORT port;
+} AmsAddr, *PAmsAddr;
+
+typedef struct AdsVersion_ {
+	UCHAR version;
+	UCHAR revision;
+	USHORT build;
+} AdsVersion, *PAdsVersion;
+
+typedef struct AdsNotificationAttrib_ {
+	ULONG cbLength;
+	ADSTRANSMODE nTransMode;
+	ULONG nMaxDelay;
+	union {
+		ULONG nCycleTime;
+		ULONG dwChangeFilter;
+	};
+} AdsNotificationAttrib, *PAdsNotificationAttrib;
+
+typedef struct AdsNotificationHeader_ {
+	int64_t nTimeStamp;
+	ULONG hNotification;
+	ULONG cbSampleSize;
+	UCHAR data[ANYSIZE_ARRAY];
+} AdsNotificationHeader, *PAdsNotificationHeader;
+
+typedef void (__stdcall *PAdsNotificationFuncEx)(AmsAddr* pAddr, AdsNotificationHeader* pNotification, ULONG hUser);
+
+typedef struct AdsSymbolUploadInfo_ {
+	ULONG nSymbols;
+	ULONG nSymSize;
+} AdsSymbolUploadInfo, *PAdsSymbolUploadInfo;
+
+typedef struct AdsSymbolUploadInfo2_ {
+	ULONG nSymbols;
+	ULONG nSymSize;
+	ULONG nDatatypes;
+	ULONG nDatatypeSize;
+	ULONG nMaxDynSymbols;
+	ULONG nUsedDynSymbols;
+} AdsSymbolUploadInfo2, *PAdsSymbolUploadInfo2;
+
+typedef struct AdsSymbolEntry_ {
+	ULONG entryLength;
+	ULONG iGroup;
+	ULONG iOffs;
+	ULONG size;
+	ULONG dataType;
+	ULONG flags;
+	USHORT nameLength;
+	USHORT typeLength;
+	USHORT commentLength;
+} AdsSymbolEntry, *PAdsSymbolEntry;
+
+typedef struct AdsDatatypeArrayInfo_ {
+	ADS_INT32 lBound;
+	ADS_UINT32 elements;
+} AdsDatatypeArrayInfo, *PAdsDatatypeArrayInfo;
+
+typedef struct AdsDatatypeEntry_ {
+	ADS_UINT32 entryLength;
+	ADS_UINT32 version;
+	union {
+		ADS_UINT32 hashValue;
+		ADS_UINT32 offsGetCode;
+	};
+	union {
+		ADS_UINT32 typeHashValue;
+		ADS_UINT32 offsSetCode;
+	};
+	ADS_UINT32 size;
+	ADS_UINT32 offs;
+	ADS_UINT32 dataType;
+	ADS_UINT32 flags;
+	ADS_UINT16 nameLength;
+	ADS_UINT16 typeLength;
+	ADS_UINT16 commentLength;
+	ADS_UINT16 arrayDim;
+	ADS_UINT16 subItems;
+} AdsDatatypeEntry, *PAdsDatatypeEntry;
+
+#pragma pack(pop)
+
+#define PADSSYMBOLNAME(p) ((char*)(((PAdsSymbolEntry)p) + 1))
+#define PADSSYMBOLTYPE(p) (((char*)(((PAdsSymbolEntry)p) + 1)) + ((PAdsSymbolEntry)p)->nameLength + 1)
+#define PADSSYMBOLCOMMENT(p) (((char*)(((PAdsSymbolEntry)p) + 1)) + ((PAdsSymbolEntry)p)->nameLength + 1 + ((PAdsSymbolEntry)p)->typeLength + 1)
+#define PADSNEXTSYMBOLENTRY(pEntry) (*((ULONG*)(((char*)pEntry) + ((PAdsSymbolEntry)pEntry)->entryLength)) \
+	? ((PAdsSymbolEntry)(((char*)pEntry) + ((PAdsSymbolEntry)pEntry)->entryLength)) : NULL)
+
+#define PADSDATATYPENAME(p) ((PCHAR)(((PAdsDatatypeEntry)p) + 1))
+#define PADSDATATYPETYPE(p) (((PCHAR)(((PAdsDatatypeEntry)p) + 1)) + ((PAdsDatatypeEntry)p)->nameLength + 1)
+#define PADSDATATYPECOMMENT(p) (((PCHAR)(((PAdsDatatypeEntry)p) + 1)) + ((PAdsDatatypeEntry)p)->nameLength + 1 + ((PAdsDatatypeEntry)p)->typeLength + 1)
+#define PADSDATATYPEARRAYINFO(p) (PAdsDatatypeArrayInfo)(((PCHAR)(((PAdsDatatypeEntry)p) + 1)) + ((PAdsDatatypeEntry)p)->nameLength + 1 \
+	+ ((PAdsDatatypeEntry)p)->typeLength + 1 + ((PAdsDatatypeEntry)p)->commentLength + 1)
+
+// Returns sub item of struct datatype entry
+inline PAdsDatatypeEntry AdsDatatypeStructItem(PAdsDatatypeEntry p, unsigned short iItem)
+{
+	if (iItem >= p->subItems)
+		return nullptr;
+	PAdsDatatypeEntry pItem = (PAdsDatatypeEntry)(((PCHAR)(p + 1)) + p->nameLength + p->typeLength + p->commentLength + 3
+		+ p->arrayDim * sizeof(AdsDatatypeArrayInfo));
+	for (unsigned short i = 0; i < iItem; i++)
+		pItem = (PAdsDatatypeEntry)(((PCHAR)pItem) + pItem->entryLength);
+	return pItem;
+}
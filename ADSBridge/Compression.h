@@ -0,0 +1,187 @@
+// Compression.h : Content codings of response bodies, negotiated by Accept-Encoding header.
+// Gzip and Brotli are available if the bridge is built with zlib and Brotli respectively.
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#ifdef ADSBRIDGE_ZLIB_SUPPORT
+#include <zlib.h>
+#endif
+#ifdef ADSBRIDGE_BROTLI_SUPPORT
+#include <brotli/encode.h>
+#endif
+
+enum class ContentEncoding { Identity, Gzip, Brotli };
+
+// Bodies of at least this many bytes are compressed, smaller ones gain too little to be worth it
+constexpr size_t COMPRESSION_THRESHOLD = 1024;
+
+// Brotli quality used for responses, the highest ones are far too slow for bodies compressed on request
+constexpr int BROTLI_RESPONSE_QUALITY = 5;
+
+// Returns name of content coding as used in Content-Encoding header
+inline const char* getContentEncodingName(ContentEncoding encoding) {
+	switch (encoding) {
+	case ContentEncoding::Gzip: return "gzip";
+	case ContentEncoding::Brotli: return "br";
+	default: return "identity";
+	}
+}
+
+// Returns available content coding with the highest quality value in Accept-Encoding header value, Brotli on a tie.
+// Codings with q=0 are refused, the wildcard applies to codings not listed themselves.
+inline ContentEncoding getContentEncoding(std::string_view acceptEncoding) {
+	// Quality values, negative while not listed
+	double gzip = -1.0;
+	double brotli = -1.0;
+	double any = -1.0;
+	while (!acceptEncoding.empty()) {
+		size_t end = acceptEncoding.find(',');
+		std::string_view item = acceptEncoding.substr(0, end);
+		acceptEncoding = end == std::string_view::npos ? std::string_view{} : acceptEncoding.substr(end + 1);
+		size_t params = item.find(';');
+		std::string coding{ item.substr(0, params) };
+		coding.erase(std::remove_if(coding.begin(), coding.end(), [](unsigned char c) { return std::isspace(c); }), coding.end());
+		std::transform(coding.begin(), coding.end(), coding.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		double q = 1.0;
+		if (params != std::string_view::npos) {
+			size_t pos = item.find("q=", params);
+			if (pos != std::string_view::npos) q = std::strtod(std::string{ item.substr(pos + 2) }.c_str(), nullptr);
+		}
+		if (coding == "gzip" || coding == "x-gzip") gzip = std::max(gzip, q);
+		else if (coding == "br") brotli = std::max(brotli, q);
+		else if (coding == "*") any = std::max(any, q);
+	}
+	if (gzip < 0.0) gzip = any;
+	if (brotli < 0.0) brotli = any;
+#ifndef ADSBRIDGE_ZLIB_SUPPORT
+	gzip = 0.0;
+#endif
+#ifndef ADSBRIDGE_BROTLI_SUPPORT
+	brotli = 0.0;
+#endif
+	if (brotli > 0.0 && brotli >= gzip) return ContentEncoding::Brotli;
+	if (gzip > 0.0) return ContentEncoding::Gzip;
+	return ContentEncoding::Identity;
+}
+
+// Compresses a body passed in consecutive chunks, output is handed to the sink as soon as it is produced
+class StreamCompressor {
+public:
+	StreamCompressor(ContentEncoding encoding, std::function<bool(const char*, size_t)> sink) : encoding(encoding), sink(std::move(sink)) {
+#ifdef ADSBRIDGE_ZLIB_SUPPORT
+		// Window bits above 15 select the gzip format
+		if (encoding == ContentEncoding::Gzip) {
+			ok = deflateInit2(&zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+		}
+#endif
+#ifdef ADSBRIDGE_BROTLI_SUPPORT
+		if (encoding == ContentEncoding::Brotli) {
+			brotli = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+			ok = brotli && BrotliEncoderSetParameter(brotli, BROTLI_PARAM_QUALITY, BROTLI_RESPONSE_QUALITY);
+		}
+#endif
+	}
+
+	StreamCompressor(const StreamCompressor&) = delete;
+	StreamCompressor& operator=(const StreamCompressor&) = delete;
+
+	~StreamCompressor() {
+#ifdef ADSBRIDGE_ZLIB_SUPPORT
+		if (encoding == ContentEncoding::Gzip) deflateEnd(&zstream);
+#endif
+#ifdef ADSBRIDGE_BROTLI_SUPPORT
+		if (brotli) BrotliEncoderDestroyInstance(brotli);
+#endif
+	}
+
+	// Compresses next chunk, the last one finishes the body. Returns false once compression or the sink failed.
+	bool write(const char* data, size_t size, bool last = false) {
+		if (!ok) return false;
+		switch (encoding) {
+#ifdef ADSBRIDGE_ZLIB_SUPPORT
+		case ContentEncoding::Gzip:
+			ok = writeGzip(data, size, last);
+			break;
+#endif
+#ifdef ADSBRIDGE_BROTLI_SUPPORT
+		case ContentEncoding::Brotli:
+			ok = writeBrotli(data, size, last);
+			break;
+#endif
+		case ContentEncoding::Identity:
+			ok = size == 0 || sink(data, size);
+			break;
+		default:
+			ok = false;
+			break;
+		}
+		return ok;
+	}
+
+private:
+#ifdef ADSBRIDGE_ZLIB_SUPPORT
+	bool writeGzip(const char* data, size_t size, bool last) {
+		char out[16 * 1024];
+		// zlib counts input in uInt, so huge chunks are passed in parts
+		do {
+			uInt part = static_cast<uInt>(std::min<size_t>(size, 1u << 30));
+			zstream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+			zstream.avail_in = part;
+			data += part;
+			size -= part;
+			int flush = last && size == 0 ? Z_FINISH : Z_NO_FLUSH;
+			int ret{};
+			do {
+				zstream.next_out = reinterpret_cast<Bytef*>(out);
+				zstream.avail_out = sizeof(out);
+				ret = deflate(&zstream, flush);
+				if (ret == Z_STREAM_ERROR) return false;
+				size_t produced = sizeof(out) - zstream.avail_out;
+				if (produced > 0 && !sink(out, produced)) return false;
+			} while (zstream.avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+		} while (size > 0);
+		return true;
+	}
+
+	z_stream zstream{};
+#endif
+#ifdef ADSBRIDGE_BROTLI_SUPPORT
+	bool writeBrotli(const char* data, size_t size, bool last) {
+		const uint8_t* next = reinterpret_cast<const uint8_t*>(data);
+		BrotliEncoderOperation operation = last ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_PROCESS;
+		do {
+			// Output is taken from the encoder instead of being copied into a buffer
+			size_t availOut = 0;
+			if (!BrotliEncoderCompressStream(brotli, operation, &size, &next, &availOut, nullptr, nullptr)) return false;
+			size_t produced = 0;
+			const uint8_t* out = BrotliEncoderTakeOutput(brotli, &produced);
+			if (produced > 0 && !sink(reinterpret_cast<const char*>(out), produced)) return false;
+		} while (size > 0 || BrotliEncoderHasMoreOutput(brotli) || (last && !BrotliEncoderIsFinished(brotli)));
+		return true;
+	}
+
+	BrotliEncoderState* brotli = nullptr;
+#endif
+	ContentEncoding encoding;
+	std::function<bool(const char*, size_t)> sink;
+	bool ok = true;
+};
+
+// Returns body compressed with given content coding, std::nullopt if compression failed
+inline std::optional<std::string> compressBody(std::string_view body, ContentEncoding encoding) {
+	std::string compressed{};
+	StreamCompressor compressor{ encoding, [&compressed](const char* data, size_t size) {
+		compressed.append(data, size);
+		return true;
+	} };
+	if (!compressor.write(body.data(), body.size(), true)) return std::nullopt;
+	return compressed;
+}
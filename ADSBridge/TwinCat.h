@@ -0,0 +1,2552 @@
+// TwinCat.h : Symbol, datatype and value handling of TwinCAT ADS devices shared by the bridge and its tests.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "include/nlohmann/json.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#include "C:\TwinCAT\AdsApi\TcAdsDll\Include\TcAdsDef.h"
+#include "C:\TwinCAT\AdsApi\TcAdsDll\Include\TcAdsApi.h"
+#else
+#include "AmsTcp/AdsDef.h"
+#include "AmsTcp/AdsApi.h"
+#endif
+
+// Integer digits of arrays are generated with SSE2 where available, MSVC does not define __SSE2__ but always has it on x64
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ADSBRIDGE_SSE2_SUPPORT
+#include <emmintrin.h>
+#endif
+
+#ifdef _WIN32
+// Result of an asynchronous request, data holds the bytes returned by read and read-write requests
+struct AdsAsyncResult {
+	long nErr;
+	std::vector<char> data;
+};
+
+// TcAdsDll offers no asynchronous requests, so these complete synchronously and return a ready future
+inline std::future<AdsAsyncResult> AdsAsyncReadReq(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nLength) {
+	AdsAsyncResult result{ 0, std::vector<char>(nLength) };
+	ULONG nRead{};
+	result.nErr = AdsSyncReadReqEx(pAddr, nIndexGroup, nIndexOffset, nLength, result.data.data(), &nRead);
+	result.data.resize(result.nErr ? 0 : nRead);
+	std::promise<AdsAsyncResult> promise{};
+	promise.set_value(std::move(result));
+	return promise.get_future();
+}
+
+inline std::future<AdsAsyncResult> AdsAsyncWriteReq(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nLength, const void* pData) {
+	std::promise<AdsAsyncResult> promise{};
+	promise.set_value(AdsAsyncResult{ AdsSyncWriteReq(pAddr, nIndexGroup, nIndexOffset, nLength, const_cast<void*>(pData)), {} });
+	return promise.get_future();
+}
+
+inline std::future<AdsAsyncResult> AdsAsyncReadWriteReq(PAmsAddr pAddr, ULONG nIndexGroup, ULONG nIndexOffset, ULONG nReadLength, ULONG nWriteLength, const void* pWriteData) {
+	AdsAsyncResult result{ 0, std::vector<char>(nReadLength) };
+	ULONG nRead{};
+	result.nErr = AdsSyncReadWriteReqEx(pAddr, nIndexGroup, nIndexOffset, nReadLength, result.data.data(), nWriteLength, const_cast<void*>(pWriteData), &nRead);
+	result.data.resize(result.nErr ? 0 : nRead);
+	std::promise<AdsAsyncResult> promise{};
+	promise.set_value(std::move(result));
+	return promise.get_future();
+}
+#endif
+
+typedef enum AdsDataType
+{
+	ADST_VOID = 0,
+	ADST_INT16 = 2,
+	ADST_INT32 = 3,
+	ADST_REAL32 = 4,
+	ADST_REAL64 = 5,
+	ADST_INT8 = 16,
+	ADST_UINT8 = 17,
+	ADST_UINT16 = 18,
+	ADST_UINT32 = 19,
+	ADST_INT64 = 20,
+	ADST_UINT64 = 21,
+	ADST_STRING = 30,
+	ADST_WSTRING = 31,
+	ADST_REAL80 = 32,
+	ADST_BIT = 33,
+	ADST_MAXTYPES = 34,
+	ADST_BIGTYPE = 65
+} ADSDATATYPE;
+
+// Splits string by separator, slash (path separator) by default
+inline std::vector<std::string> splitPath(std::string path, const std::string& separator = "/") {
+	std::vector<std::string> paths{};
+	for (size_t pos = 0; (pos = path.find(separator)) != std::string::npos; (pos = path.find(separator))) {
+		paths.push_back(path.substr(0, pos));
+		path.erase(0, pos + separator.size());
+	}
+	paths.push_back(path);
+	return paths;
+}
+
+// Appends number as JSON text without intermediate streams, floating point numbers in the shortest form that reads back to the same value.
+// JSON has no NaN or infinity, so those are null.
+inline void appendJSONNumber(std::string& str, auto value) {
+	if constexpr (std::is_floating_point_v<decltype(value)>) {
+		if (!std::isfinite(value)) {
+			str.append("null");
+			return;
+		}
+	}
+	char chars[32];
+	auto [ptr, ec] = std::to_chars(chars, chars + sizeof(chars), +value);
+	str.append(chars, ptr);
+}
+
+// Returns data at index group and offset depending on data type
+auto readGroupOffset(PAmsAddr pAddr, const ULONG& indexGroup, const ULONG& indexOffset, auto&& pData) {
+	auto data{ pData };
+	long nErr = AdsSyncReadReq(pAddr, indexGroup, indexOffset, sizeof(data), &data);
+	return std::pair(nErr, data);
+}
+
+// Returns data at index group and offset depending on data type and updates nErr parameter accordingly
+auto readGroupOffset(PAmsAddr pAddr, const ULONG& indexGroup, const ULONG& indexOffset, auto&& pData, long& nErr) {
+	auto [err, data] = readGroupOffset(pAddr, indexGroup, indexOffset, pData);
+	nErr = err;
+	return std::pair(nErr, data);
+}
+
+// Returns data at index group and offset depending on data type and updates nErr as well as str parameter accordingly
+auto readGroupOffset(PAmsAddr pAddr, const ULONG& indexGroup, const ULONG& indexOffset, auto&& pData, long& nErr, std::string& str) {
+	auto [err, data] = readGroupOffset(pAddr, indexGroup, indexOffset, pData, nErr);
+	str.clear();
+	appendJSONNumber(str, data);
+	return std::pair(nErr, str);
+}
+
+// Returns data at offset of buffer depending on data type
+auto readBufferOffset(std::span<const char> buffer, const ULONG& offset, auto&& pData) {
+	auto data{ pData };
+	long nErr{};
+	if (offset + sizeof(data) > buffer.size()) {
+		nErr = ADSERR_DEVICE_INVALIDSIZE;
+	}
+	else {
+		memcpy(&data, buffer.data() + offset, sizeof(data));
+	}
+	return std::pair(nErr, data);
+}
+
+// Returns data at offset of buffer depending on data type and updates nErr parameter accordingly
+auto readBufferOffset(std::span<const char> buffer, const ULONG& offset, auto&& pData, long& nErr) {
+	auto [err, data] = readBufferOffset(buffer, offset, pData);
+	nErr = err;
+	return std::pair(nErr, data);
+}
+
+// Returns data at offset of buffer depending on data type and updates nErr as well as str parameter accordingly
+auto readBufferOffset(std::span<const char> buffer, const ULONG& offset, auto&& pData, long& nErr, std::string& str) {
+	auto [err, data] = readBufferOffset(buffer, offset, pData, nErr);
+	str.clear();
+	appendJSONNumber(str, data);
+	return std::pair(nErr, str);
+}
+
+// Writes given data at index group and offset
+auto writeGroupOffset(PAmsAddr pAddr, const ULONG& indexGroup, const ULONG& indexOffset, const auto& data) {
+	auto rData{ data };
+	long nErr = AdsSyncWriteReq(pAddr, indexGroup, indexOffset, sizeof(rData), &rData);
+	return nErr;
+}
+
+// Writes given data at offset of buffer
+auto writeBufferOffset(std::span<char> buffer, const ULONG& offset, const auto& data) {
+	if (offset + sizeof(data) > buffer.size()) {
+		return static_cast<long>(ADSERR_DEVICE_INVALIDSIZE);
+	}
+	memcpy(buffer.data() + offset, &data, sizeof(data));
+	return 0L;
+}
+
+// Reads all bytes of symbol/variable from handle
+inline auto getSymValueByHandle(PAmsAddr pAddr, const ULONG& symHandle, ULONG size) {
+	std::vector<char> buffer(size);
+	long nErr = AdsSyncReadReq(pAddr, ADSIGRP_SYM_VALBYHND, symHandle, size, buffer.data());
+	return std::make_pair(nErr, buffer);
+}
+
+struct TwinCatArray {
+	unsigned long   bound;
+	unsigned long   size;
+};
+
+struct TwinCatType {
+	std::string name;
+	std::string type;
+	std::string comment;
+	std::map<std::string, TwinCatType> subItems;
+	ADS_UINT32		entryLength;
+	ADS_UINT32		version;
+	ADS_UINT32		size;
+	ADS_UINT32		offs;
+	ADS_UINT32		dataType;
+	ADS_UINT32		flags;
+	ADS_UINT16		arrayDim;
+	std::vector<TwinCatArray>   arrayVector;
+};
+
+// Store symbol/variable declaration. Name, type and comment are views into the symbol upload held by TwinCatSymbolTable,
+// the type is referenced by its name, which is the key of its declaration and layout in the snapshot.
+struct TwinCatVar {
+	std::string_view name;
+	ULONG indexGroup;
+	ULONG indexOffset;
+	ULONG size;
+	std::string_view type;
+	std::string_view comment;
+	std::string str() const {
+		std::stringstream strstream;
+		strstream << "{\"Name\":\"" << name << "\",";
+		strstream << "\"IndexGroup\":" << indexGroup << ",";
+		strstream << "\"IndexOffset\":" << indexOffset << ",";
+		strstream << "\"Size\":" << size << ",";
+		strstream << "\"Type\":\"" << type << "\",";
+		strstream << "\"Comment\":\"" << comment << "\"}";
+		return strstream.str();
+	}
+};
+
+// Member of symbol/variable resolved from its path, which owns the path it is named by
+struct TwinCatMember : TwinCatVar {
+	TwinCatMember(const TwinCatVar& variable, std::string path) : TwinCatVar(variable), path(std::move(path)) {
+		name = this->path;
+	}
+
+	TwinCatMember(const TwinCatMember& other) : TwinCatMember(other, other.path) {}
+
+	TwinCatMember& operator=(const TwinCatMember& other) {
+		TwinCatVar::operator=(other);
+		path = other.path;
+		name = path;
+		return *this;
+	}
+
+private:
+	std::string path;
+};
+
+// Symbols/variables of one symbol upload sorted by name. Instead of copying names, types and comments out of the upload,
+// declarations are views into it and the table keeps the upload alive, so memory scales with the size of the upload.
+// Names are looked up through a flat hash index built along with the table, the sorted order serves listings.
+class TwinCatSymbolTable {
+public:
+	using const_iterator = std::vector<TwinCatVar>::const_iterator;
+
+	TwinCatSymbolTable() = default;
+
+	TwinCatSymbolTable(std::shared_ptr<const char[]> upload, std::vector<TwinCatVar> declarations) : upload(std::move(upload)) {
+		std::stable_sort(declarations.begin(), declarations.end(), [](const TwinCatVar& a, const TwinCatVar& b) { return a.name < b.name; });
+		// Later declarations of a name replace earlier ones
+		symbols.reserve(declarations.size());
+		for (size_t i = 0; i < declarations.size(); i++) {
+			if (i + 1 < declarations.size() && declarations[i + 1].name == declarations[i].name) continue;
+			symbols.push_back(declarations[i]);
+		}
+		// Hash index is kept at most half full, so probe sequences stay short
+		slots.assign(std::bit_ceil(std::max<size_t>(symbols.size() * 2, 8)), Slot{ 0, EMPTY_SLOT });
+		for (size_t i = 0; i < symbols.size(); i++) {
+			size_t hash = std::hash<std::string_view>{}(symbols[i].name);
+			size_t slot = hash & (slots.size() - 1);
+			while (slots[slot].index != EMPTY_SLOT) slot = (slot + 1) & (slots.size() - 1);
+			slots[slot] = Slot{ static_cast<uint32_t>(hash), static_cast<uint32_t>(i) };
+		}
+	}
+
+	const_iterator begin() const { return symbols.begin(); }
+	const_iterator end() const { return symbols.end(); }
+	size_t size() const { return symbols.size(); }
+	bool empty() const { return symbols.empty(); }
+
+	// Returns symbol/variable with given name or end(), looked up in the hash index
+	const_iterator find(std::string_view name) const {
+		if (slots.empty()) return symbols.end();
+		size_t hash = std::hash<std::string_view>{}(name);
+		for (size_t slot = hash & (slots.size() - 1);; slot = (slot + 1) & (slots.size() - 1)) {
+			const Slot& entry = slots[slot];
+			if (entry.index == EMPTY_SLOT) return symbols.end();
+			// Names are only compared if the stored hash matches
+			if (entry.hash == static_cast<uint32_t>(hash) && symbols[entry.index].name == name) return symbols.begin() + entry.index;
+		}
+	}
+
+	// Returns first symbol/variable whose name is not less than given name
+	const_iterator lower_bound(std::string_view name) const {
+		return std::lower_bound(symbols.begin(), symbols.end(), name, [](const TwinCatVar& variable, std::string_view value) { return variable.name < value; });
+	}
+
+	// Returns first symbol/variable whose name is greater than given name
+	const_iterator upper_bound(std::string_view name) const {
+		return std::upper_bound(symbols.begin(), symbols.end(), name, [](std::string_view value, const TwinCatVar& variable) { return value < variable.name; });
+	}
+
+private:
+	// Slot of the open addressing hash index, holding the lower bits of the name's hash and the position of the symbol/variable
+	struct Slot {
+		uint32_t hash;
+		uint32_t index;
+	};
+
+	static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+	std::shared_ptr<const char[]> upload;
+	std::vector<TwinCatVar> symbols;
+	// Linearly probed, the number of slots is a power of two
+	std::vector<Slot> slots;
+};
+
+// Array dimension of flattened type layout
+struct TwinCatLayoutDim {
+	ADS_INT32 lBound;
+	ULONG elements;
+	// Distance in bytes between two consecutive indices of this dimension
+	ULONG stride;
+};
+
+// Node of flattened type layout, either a primitive or a struct whose members directly follow it
+struct TwinCatLayoutNode {
+	std::string name;
+	// Offset relative to start of parent struct
+	ULONG offset;
+	// Size of a single element
+	ULONG size;
+	ULONG dataType;
+	// Number of direct members, 0 for primitives
+	ULONG subItems;
+	// Index of first node after this node and its members
+	ULONG end;
+	// Array dimensions of node stored in TwinCatLayout::dims, dimCount is 0 if node is no array
+	ULONG firstDim;
+	ULONG dimCount;
+};
+
+// Datatype resolved once into a contiguous vector of nodes in pre-order, root node has index 0
+struct TwinCatLayout {
+	std::vector<TwinCatLayoutNode> nodes;
+	std::vector<TwinCatLayoutDim> dims;
+
+	// Returns array dimensions of node
+	std::span<const TwinCatLayoutDim> getDims(ULONG index) const {
+		return std::span<const TwinCatLayoutDim>(dims).subspan(nodes[index].firstDim, nodes[index].dimCount);
+	}
+};
+
+// Returns text converted to lowercase, names of symbols/variables are case insensitive
+inline std::string toLowerCase(std::string_view text) {
+	std::string lower(text);
+	std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return lower;
+}
+
+// Returns whether the whole text matches glob pattern, * matches any sequence of characters and ? any single character
+inline bool matchGlob(std::string_view pattern, std::string_view text) {
+	size_t p = 0;
+	size_t t = 0;
+	// Position of last * in pattern and of text it currently matches up to, which is extended when the rest does not match
+	size_t star = std::string_view::npos;
+	size_t mark = 0;
+	while (t < text.size()) {
+		if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t])) {
+			p++;
+			t++;
+		}
+		else if (p < pattern.size() && pattern[p] == '*') {
+			star = p++;
+			mark = t;
+		}
+		else if (star != std::string_view::npos) {
+			p = star + 1;
+			t = ++mark;
+		}
+		else {
+			return false;
+		}
+	}
+	while (p < pattern.size() && pattern[p] == '*') p++;
+	return p == pattern.size();
+}
+
+// Lowercase name, type name and comment of symbol/variable, computed once when the index is built
+struct TwinCatSymbolKey {
+	std::string name;
+	std::string type;
+	std::string comment;
+	const TwinCatVar* variable;
+};
+
+// Case insensitive search index over symbols/variables, sorted by lowercase name.
+// Keys point into the symbol table the index was built from, which stay valid when the table is moved into the snapshot.
+struct TwinCatSymbolIndex {
+	std::vector<TwinCatSymbolKey> keys;
+
+	// Returns keys of names starting with lowercase prefix
+	std::span<const TwinCatSymbolKey> withPrefix(std::string_view prefix) const {
+		auto first = std::lower_bound(keys.begin(), keys.end(), prefix, [](const TwinCatSymbolKey& key, std::string_view value) { return key.name < value; });
+		auto last = std::partition_point(first, keys.end(), [prefix](const TwinCatSymbolKey& key) { return key.name.starts_with(prefix); });
+		return std::span<const TwinCatSymbolKey>(first, last);
+	}
+};
+
+// Immutable symbol/variable and datatype declarations of one symbol table version
+struct TwinCatSnapshot {
+	TwinCatSymbolTable symbols;
+	std::map<std::string, TwinCatType> datatypes;
+	// Resolved layouts, keyed by datatype name
+	std::map<std::string, TwinCatLayout, std::less<>> layouts;
+	// Search index over symbols
+	TwinCatSymbolIndex index;
+	// Incremented by the bridge every time a new snapshot is published
+	uint64_t version = 0;
+
+	// Returns symbol/variable with given name or nullptr if it does not exist
+	const TwinCatVar* findSymbol(std::string_view name) const {
+		auto it = symbols.find(name);
+		return it != symbols.end() ? &*it : nullptr;
+	}
+
+	// Returns resolved layout of symbol/variable, unknown datatypes resolve to ADST_VOID
+	const TwinCatLayout& findLayout(const TwinCatVar& variable) const {
+		static const TwinCatLayout voidLayout{ { TwinCatLayoutNode{ "", 0, 0, ADST_VOID, 0, 1, 0, 0 } }, {} };
+		auto it = layouts.find(variable.type);
+		return it != layouts.end() ? it->second : voidLayout;
+	}
+};
+
+// Reads all bytes of symbol/variable with a single ADS request
+inline auto readVariableBuffer(PAmsAddr pAddr, const TwinCatVar& variable) {
+	std::vector<char> buffer(variable.size);
+	long nErr = AdsSyncReadReq(pAddr, variable.indexGroup, variable.indexOffset, variable.size, buffer.data());
+	return std::make_pair(nErr, buffer);
+}
+
+// Maximum number of sub commands accepted by the PLC within one ADS sum command
+constexpr size_t MAX_SUM_COMMANDS = 500;
+
+// Index group, offset and length of memory area read or written by an ADS request
+struct TwinCatRange {
+	ULONG indexGroup;
+	ULONG indexOffset;
+	ULONG size;
+};
+
+// Returns memory areas of given symbols/variables
+inline std::vector<TwinCatRange> getVariableRanges(const std::vector<const TwinCatVar*>& variables) {
+	std::vector<TwinCatRange> ranges{};
+	for (const TwinCatVar* variable : variables) {
+		ranges.push_back(TwinCatRange{ variable->indexGroup, variable->indexOffset, variable->size });
+	}
+	return ranges;
+}
+
+// Reads all bytes of given symbols/variables or ranges using ADS sum read requests (ADSIGRP_SUMUP_READ),
+// all sum requests are sent before the first response is awaited
+auto readVariableBuffers(PAmsAddr pAddr, const auto& variables) {
+	std::vector<std::future<AdsAsyncResult>> responses{};
+	for (size_t first = 0; first < variables.size(); first += MAX_SUM_COMMANDS) {
+		size_t count = std::min(MAX_SUM_COMMANDS, variables.size() - first);
+		std::vector<ULONG> request{};
+		ULONG readLength = static_cast<ULONG>(count * sizeof(ULONG));
+		for (size_t i = first; i < first + count; i++) {
+			request.insert(request.end(), { variables[i].indexGroup, variables[i].indexOffset, variables[i].size });
+			readLength += variables[i].size;
+		}
+		responses.push_back(AdsAsyncReadWriteReq(pAddr, ADSIGRP_SUMUP_READ, static_cast<ULONG>(count), readLength, static_cast<ULONG>(request.size() * sizeof(ULONG)), request.data()));
+	}
+	std::vector<std::pair<long, std::vector<char>>> buffers{};
+	for (size_t first = 0; first < variables.size(); first += MAX_SUM_COMMANDS) {
+		size_t count = std::min(MAX_SUM_COMMANDS, variables.size() - first);
+		AdsAsyncResult response = responses[first / MAX_SUM_COMMANDS].get();
+		// Response starts with one error code per sub command followed by the data of all sub commands
+		size_t dataOffset = count * sizeof(ULONG);
+		for (size_t i = 0; i < count; i++) {
+			const auto& variable = variables[first + i];
+			if (!response.nErr && dataOffset + variable.size > response.data.size()) response.nErr = ADSERR_DEVICE_INVALIDSIZE;
+			if (response.nErr) {
+				buffers.push_back(std::make_pair(response.nErr, std::vector<char>{}));
+				continue;
+			}
+			ULONG err{};
+			memcpy(&err, response.data.data() + i * sizeof(ULONG), sizeof(err));
+			auto data = response.data.begin() + dataOffset;
+			buffers.push_back(std::make_pair(static_cast<long>(err), std::vector<char>(data, data + variable.size)));
+			dataOffset += variable.size;
+		}
+	}
+	return buffers;
+}
+
+// Writes all bytes of given symbols/variables or ranges using ADS sum write requests (ADSIGRP_SUMUP_WRITE) and returns error code of each write,
+// all sum requests are sent before the first response is awaited
+auto writeVariableBuffers(PAmsAddr pAddr, const auto& variables, const std::vector<std::vector<char>>& buffers) {
+	std::vector<std::future<AdsAsyncResult>> responses{};
+	for (size_t first = 0; first < variables.size(); first += MAX_SUM_COMMANDS) {
+		size_t count = std::min(MAX_SUM_COMMANDS, variables.size() - first);
+		// Request starts with index group, offset and length of every sub command followed by the data of all sub commands
+		std::vector<char> request(count * 3 * sizeof(ULONG));
+		for (size_t i = 0; i < count; i++) {
+			const auto& variable = variables[first + i];
+			ULONG header[3]{ variable.indexGroup, variable.indexOffset, variable.size };
+			memcpy(request.data() + i * sizeof(header), header, sizeof(header));
+			request.insert(request.end(), buffers[first + i].begin(), buffers[first + i].end());
+		}
+		responses.push_back(AdsAsyncReadWriteReq(pAddr, ADSIGRP_SUMUP_WRITE, static_cast<ULONG>(count), static_cast<ULONG>(count * sizeof(ULONG)), static_cast<ULONG>(request.size()), request.data()));
+	}
+	std::vector<long> errors{};
+	for (size_t first = 0; first < variables.size(); first += MAX_SUM_COMMANDS) {
+		size_t count = std::min(MAX_SUM_COMMANDS, variables.size() - first);
+		AdsAsyncResult response = responses[first / MAX_SUM_COMMANDS].get();
+		if (!response.nErr && response.data.size() < count * sizeof(ULONG)) response.nErr = ADSERR_DEVICE_INVALIDSIZE;
+		for (size_t i = 0; i < count; i++) {
+			ULONG err{};
+			if (!response.nErr) memcpy(&err, response.data.data() + i * sizeof(ULONG), sizeof(err));
+			errors.push_back(response.nErr ? response.nErr : static_cast<long>(err));
+		}
+	}
+	return errors;
+}
+
+// Default of the largest number of unused bytes between two ranges that are still read as one
+constexpr ULONG MAX_MERGE_GAP = 64;
+
+// Memory area read once for several ranges, parts hold index of every contained range and its offset within the area
+struct TwinCatMergedRange {
+	TwinCatRange range;
+	std::vector<std::pair<size_t, ULONG>> parts;
+};
+
+// Sorts ranges by index group and offset and merges ranges of the same index group which overlap or are at most maxGap bytes apart
+inline std::vector<TwinCatMergedRange> getMergedRanges(const std::vector<TwinCatRange>& ranges, ULONG maxGap) {
+	std::vector<size_t> order(ranges.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&ranges](size_t a, size_t b) {
+		return std::tie(ranges[a].indexGroup, ranges[a].indexOffset) < std::tie(ranges[b].indexGroup, ranges[b].indexOffset);
+	});
+	std::vector<TwinCatMergedRange> merged{};
+	for (size_t index : order) {
+		const TwinCatRange& range = ranges[index];
+		if (!merged.empty()) {
+			TwinCatRange& last = merged.back().range;
+			uint64_t lastEnd = static_cast<uint64_t>(last.indexOffset) + last.size;
+			if (last.indexGroup == range.indexGroup && range.indexOffset <= lastEnd + maxGap) {
+				uint64_t end = std::max(lastEnd, static_cast<uint64_t>(range.indexOffset) + range.size);
+				last.size = static_cast<ULONG>(end - last.indexOffset);
+				merged.back().parts.push_back(std::make_pair(index, range.indexOffset - last.indexOffset));
+				continue;
+			}
+		}
+		merged.push_back(TwinCatMergedRange{ range, { std::make_pair(index, ULONG{ 0 }) } });
+	}
+	return merged;
+}
+
+// Reads all bytes of given ranges with as few ADS sub commands as possible by merging adjacent ranges,
+// the result of every range is sliced out of its merged range. Ranges of a failed merged read are read again individually.
+inline auto readMergedBuffers(PAmsAddr pAddr, const std::vector<TwinCatRange>& ranges, ULONG maxGap = MAX_MERGE_GAP) {
+	std::vector<TwinCatMergedRange> merged = getMergedRanges(ranges, maxGap);
+	std::vector<TwinCatRange> reads{};
+	for (const TwinCatMergedRange& mergedRange : merged) {
+		reads.push_back(mergedRange.range);
+	}
+	auto results = readVariableBuffers(pAddr, reads);
+	std::vector<std::pair<long, std::vector<char>>> buffers(ranges.size());
+	std::vector<TwinCatRange> retries{};
+	std::vector<size_t> retryIndices{};
+	for (size_t i = 0; i < merged.size(); i++) {
+		auto& [nErr, buffer] = results[i];
+		for (const auto& [index, offset] : merged[i].parts) {
+			if (nErr && merged[i].parts.size() > 1) {
+				retries.push_back(ranges[index]);
+				retryIndices.push_back(index);
+			}
+			else if (nErr) {
+				buffers[index] = std::make_pair(nErr, std::vector<char>{});
+			}
+			else {
+				auto data = buffer.begin() + offset;
+				buffers[index] = std::make_pair(0L, std::vector<char>(data, data + ranges[index].size));
+			}
+		}
+	}
+	if (!retries.empty()) {
+		auto retried = readVariableBuffers(pAddr, retries);
+		for (size_t i = 0; i < retried.size(); i++) {
+			buffers[retryIndices[i]] = std::move(retried[i]);
+		}
+	}
+	return buffers;
+}
+
+// Gets handles for given symbols/variables using ADS sum read-write requests (ADSIGRP_SUMUP_READWRITE),
+// all sum requests are sent before the first response is awaited
+inline auto getSymHandlesByName(PAmsAddr pAddr, const std::vector<std::string>& varNames) {
+	std::vector<std::future<AdsAsyncResult>> responses{};
+	for (size_t first = 0; first < varNames.size(); first += MAX_SUM_COMMANDS) {
+		size_t count = std::min(MAX_SUM_COMMANDS, varNames.size() - first);
+		// Request starts with index group, offset, read and write length of every sub command followed by the names
+		std::vector<char> request(count * 4 * sizeof(ULONG));
+		for (size_t i = 0; i < count; i++) {
+			const std::string& varName = varNames[first + i];
+			ULONG header[4]{ ADSIGRP_SYM_HNDBYNAME, 0x0, sizeof(ULONG), static_cast<ULONG>(varName.length()) };
+			memcpy(request.data() + i * sizeof(header), header, sizeof(header));
+			request.insert(request.end(), varName.begin(), varName.end());
+		}
+		responses.push_back(AdsAsyncReadWriteReq(pAddr, ADSIGRP_SUMUP_READWRITE, static_cast<ULONG>(count), static_cast<ULONG>(count * 3 * sizeof(ULONG)), static_cast<ULONG>(request.size()), request.data()));
+	}
+	std::vector<std::pair<long, ULONG>> symHandles{};
+	for (size_t first = 0; first < varNames.size(); first += MAX_SUM_COMMANDS) {
+		size_t count = std::min(MAX_SUM_COMMANDS, varNames.size() - first);
+		AdsAsyncResult response = responses[first / MAX_SUM_COMMANDS].get();
+		// Response starts with error code and returned length of every sub command followed by the handles
+		std::vector<ULONG> values(count * 3);
+		if (!response.nErr) memcpy(values.data(), response.data.data(), std::min(response.data.size(), values.size() * sizeof(ULONG)));
+		size_t dataIndex = count * 2;
+		for (size_t i = 0; i < count; i++) {
+			if (response.nErr) {
+				symHandles.push_back(std::make_pair(response.nErr, ULONG{}));
+				continue;
+			}
+			long err = values[i * 2];
+			ULONG length = values[i * 2 + 1];
+			ULONG symHandle = (!err && length == sizeof(ULONG) && dataIndex < values.size()) ? values[dataIndex] : 0;
+			dataIndex += length / sizeof(ULONG);
+			symHandles.push_back(std::make_pair(err, symHandle));
+		}
+	}
+	return symHandles;
+}
+
+// Releases given handles using ADS sum write requests (ADSIGRP_SUMUP_WRITE)
+inline auto releaseSymHandles(PAmsAddr pAddr, const std::vector<ULONG>& symHandles) {
+	std::vector<TwinCatRange> ranges(symHandles.size(), TwinCatRange{ ADSIGRP_SYM_RELEASEHND, 0x0, sizeof(ULONG) });
+	std::vector<std::vector<char>> buffers{};
+	for (const ULONG& symHandle : symHandles) {
+		buffers.push_back(std::vector<char>((const char*)&symHandle, (const char*)&symHandle + sizeof(symHandle)));
+	}
+	return writeVariableBuffers(pAddr, ranges, buffers);
+}
+
+// Returns true if error indicates that a handle is no longer valid for the current symbol table
+inline bool isSymHandleInvalid(long nErr) {
+	return nErr == ADSERR_DEVICE_SYMBOLNOTFOUND || nErr == ADSERR_DEVICE_SYMBOLVERSIONINVALID || nErr == ADSERR_DEVICE_NOTFOUND;
+}
+
+// Bridge-wide cache of symbol/variable handles, keyed by name
+class TwinCatHandleCache {
+public:
+	// Returns handles for given symbols/variables, missing handles are acquired with a single sum request
+	std::vector<std::pair<long, ULONG>> acquire(PAmsAddr pAddr, const std::vector<std::string>& varNames) {
+		std::vector<std::pair<long, ULONG>> symHandles(varNames.size());
+		std::vector<std::string> missingNames{};
+		std::vector<size_t> missingIndices{};
+		{
+			std::lock_guard lock{ mutex };
+			for (size_t i = 0; i < varNames.size(); i++) {
+				auto it = handles.find(varNames[i]);
+				if (it != handles.end()) {
+					symHandles[i] = std::make_pair(0L, it->second);
+				}
+				else {
+					missingNames.push_back(varNames[i]);
+					missingIndices.push_back(i);
+				}
+			}
+		}
+		if (missingNames.empty()) return symHandles;
+		auto acquired = getSymHandlesByName(pAddr, missingNames);
+		std::vector<ULONG> duplicates{};
+		{
+			std::lock_guard lock{ mutex };
+			for (size_t i = 0; i < acquired.size(); i++) {
+				auto [nErr, symHandle] = acquired[i];
+				if (!nErr) {
+					// Another request may have acquired the same handle in the meantime
+					auto [it, inserted] = handles.try_emplace(missingNames[i], symHandle);
+					if (!inserted) {
+						duplicates.push_back(symHandle);
+						symHandle = it->second;
+					}
+				}
+				symHandles[missingIndices[i]] = std::make_pair(nErr, symHandle);
+			}
+		}
+		if (!duplicates.empty()) releaseSymHandles(pAddr, duplicates);
+		return symHandles;
+	}
+
+	// Returns handle for given symbol/variable, acquiring it if missing
+	std::pair<long, ULONG> acquire(PAmsAddr pAddr, const std::string& varName) {
+		return acquire(pAddr, std::vector<std::string>{ varName }).front();
+	}
+
+	// Removes handle of given symbol/variable from cache after it turned out to be invalid
+	void invalidate(PAmsAddr pAddr, const std::string& varName) {
+		std::vector<ULONG> symHandles{};
+		{
+			std::lock_guard lock{ mutex };
+			auto it = handles.find(varName);
+			if (it == handles.end()) return;
+			symHandles.push_back(it->second);
+			handles.erase(it);
+		}
+		releaseSymHandles(pAddr, symHandles);
+	}
+
+	// Releases all cached handles, e.g. after the symbol table changed
+	void release(PAmsAddr pAddr) {
+		std::vector<ULONG> symHandles{};
+		{
+			std::lock_guard lock{ mutex };
+			for (const auto& [key, value] : handles) {
+				symHandles.push_back(value);
+			}
+			handles.clear();
+		}
+		if (!symHandles.empty()) releaseSymHandles(pAddr, symHandles);
+	}
+
+private:
+	std::mutex mutex;
+	std::map<std::string, ULONG> handles;
+};
+
+// Reads all bytes of symbol/variable through cached handle, reacquiring the handle once if it became invalid
+inline auto readVariableBufferByHandle(PAmsAddr pAddr, TwinCatHandleCache& handles, const TwinCatVar& variable) {
+	std::pair<long, std::vector<char>> result{};
+	for (int attempt = 0; attempt < 2; attempt++) {
+		auto [nErr, symHandle] = handles.acquire(pAddr, std::string(variable.name));
+		if (nErr) return std::make_pair(nErr, std::vector<char>{});
+		result = getSymValueByHandle(pAddr, symHandle, variable.size);
+		if (!isSymHandleInvalid(result.first)) break;
+		handles.invalidate(pAddr, std::string(variable.name));
+	}
+	return result;
+}
+
+// Reads all bytes of given symbols/variables through cached handles using ADS sum read requests, reacquiring invalid handles once
+inline auto readVariableBuffersByHandle(PAmsAddr pAddr, TwinCatHandleCache& handles, const std::vector<const TwinCatVar*>& variables) {
+	std::vector<std::pair<long, std::vector<char>>> buffers(variables.size());
+	std::vector<size_t> pending(variables.size());
+	std::iota(pending.begin(), pending.end(), 0);
+	for (int attempt = 0; attempt < 2 && !pending.empty(); attempt++) {
+		std::vector<std::string> varNames{};
+		for (size_t index : pending) {
+			varNames.emplace_back(variables[index]->name);
+		}
+		auto symHandles = handles.acquire(pAddr, varNames);
+		std::vector<TwinCatRange> ranges{};
+		std::vector<size_t> rangeIndices{};
+		for (size_t i = 0; i < pending.size(); i++) {
+			auto [nErr, symHandle] = symHandles[i];
+			if (nErr) {
+				buffers[pending[i]] = std::make_pair(nErr, std::vector<char>{});
+			}
+			else {
+				ranges.push_back(TwinCatRange{ ADSIGRP_SYM_VALBYHND, symHandle, variables[pending[i]]->size });
+				rangeIndices.push_back(pending[i]);
+			}
+		}
+		auto results = readVariableBuffers(pAddr, ranges);
+		pending.clear();
+		for (size_t i = 0; i < results.size(); i++) {
+			buffers[rangeIndices[i]] = std::move(results[i]);
+			if (isSymHandleInvalid(buffers[rangeIndices[i]].first)) {
+				handles.invalidate(pAddr, std::string(variables[rangeIndices[i]]->name));
+				pending.push_back(rangeIndices[i]);
+			}
+		}
+	}
+	return buffers;
+}
+
+// Maximum number of device notifications the bridge registers at the PLC
+constexpr size_t MAX_NOTIFICATIONS = 500;
+
+// Latest value of symbol/variable received through ADS device notification
+struct TwinCatNotification {
+	std::string name;
+	ULONG hNotification;
+	ADSTRANSMODE transMode;
+	ULONG cycleTime;
+	ULONG maxDelay;
+	std::chrono::milliseconds idleTimeout;
+	std::vector<char> buffer;
+	int64_t timestamp;
+	bool received;
+	std::chrono::steady_clock::time_point updated;
+	std::chrono::steady_clock::time_point accessed;
+};
+
+// Value cache fed by ADS device notifications of subscribed symbols/variables
+class TwinCatNotificationCache {
+public:
+	TwinCatNotificationCache() {
+		std::lock_guard lock{ registryMutex };
+		id = nextId++;
+		registry[id] = this;
+	}
+
+	~TwinCatNotificationCache() {
+		std::lock_guard lock{ registryMutex };
+		registry.erase(id);
+	}
+
+	// Registers device notification for symbol/variable, times are given in milliseconds. A subscribed symbol/variable
+	// keeps its notification if transmission settings are unchanged and is registered again with the new ones otherwise.
+	long subscribe(PAmsAddr pAddr, const TwinCatVar& variable, ADSTRANSMODE transMode, ULONG cycleTime, ULONG maxDelay, std::chrono::milliseconds idleTimeout) {
+		ULONG hUser{};
+		std::string varName{ variable.name };
+		bool changed = false;
+		{
+			std::lock_guard lock{ mutex };
+			if (users.contains(varName)) {
+				TwinCatNotification& notification = notifications[users[varName]];
+				changed = notification.transMode != transMode || notification.cycleTime != cycleTime || notification.maxDelay != maxDelay;
+				if (!changed) {
+					notification.idleTimeout = idleTimeout;
+					notification.accessed = std::chrono::steady_clock::now();
+					return 0;
+				}
+			}
+		}
+		if (changed) unsubscribe(pAddr, varName);
+		{
+			std::lock_guard lock{ mutex };
+			// Subscribed concurrently in between, the settings of that request apply
+			if (users.contains(varName)) return 0;
+			if (notifications.size() >= MAX_NOTIFICATIONS) {
+				return ADSERR_DEVICE_NOMOREHDLS;
+			}
+			hUser = (id << 24) | (nextUser++ & 0xFFFFFF);
+			auto now = std::chrono::steady_clock::now();
+			notifications[hUser] = TwinCatNotification{ varName, 0, transMode, cycleTime, maxDelay, idleTimeout, std::vector<char>(variable.size), 0, false, now, now };
+			users[varName] = hUser;
+		}
+		// Cycle time and maximum delay are expected in 100ns units, longer ones than fit are clamped
+		AdsNotificationAttrib attrib{};
+		attrib.cbLength = variable.size;
+		attrib.nTransMode = transMode;
+		attrib.nMaxDelay = static_cast<ULONG>(std::min<uint64_t>(uint64_t{ maxDelay } * 10000, std::numeric_limits<ULONG>::max()));
+		attrib.nCycleTime = static_cast<ULONG>(std::min<uint64_t>(uint64_t{ cycleTime } * 10000, std::numeric_limits<ULONG>::max()));
+		ULONG hNotification{};
+		long nErr = AdsSyncAddDeviceNotificationReq(pAddr, variable.indexGroup, variable.indexOffset, &attrib, &TwinCatNotificationCache::callback, hUser, &hNotification);
+		std::lock_guard lock{ mutex };
+		if (nErr) {
+			notifications.erase(hUser);
+			users.erase(varName);
+		}
+		else {
+			notifications[hUser].hNotification = hNotification;
+		}
+		return nErr;
+	}
+
+	// Deletes device notification of symbol/variable
+	long unsubscribe(PAmsAddr pAddr, const std::string& varName) {
+		ULONG hNotification{};
+		{
+			std::lock_guard lock{ mutex };
+			if (!users.contains(varName)) return ADSERR_DEVICE_NOTIFYHNDINVALID;
+			ULONG hUser = users[varName];
+			hNotification = notifications[hUser].hNotification;
+			notifications.erase(hUser);
+			users.erase(varName);
+		}
+		return AdsSyncDelDeviceNotificationReq(pAddr, hNotification);
+	}
+
+	// Returns cached bytes and PLC timestamp of symbol/variable if a value was received within maxAge
+	std::optional<std::pair<std::vector<char>, int64_t>> get(const std::string& varName, std::chrono::milliseconds maxAge = std::chrono::milliseconds::max()) {
+		std::lock_guard lock{ mutex };
+		if (!users.contains(varName)) return std::nullopt;
+		TwinCatNotification& notification = notifications[users[varName]];
+		auto now = std::chrono::steady_clock::now();
+		notification.accessed = now;
+		if (!notification.received || std::chrono::duration_cast<std::chrono::milliseconds>(now - notification.updated) > maxAge) return std::nullopt;
+		return std::make_pair(notification.buffer, notification.timestamp);
+	}
+
+	// Deletes device notifications that were not accessed within their idle timeout
+	void expire(PAmsAddr pAddr) {
+		std::vector<std::string> varNames{};
+		{
+			std::lock_guard lock{ mutex };
+			auto now = std::chrono::steady_clock::now();
+			for (const auto& [hUser, notification] : notifications) {
+				if (now - notification.accessed > notification.idleTimeout) {
+					varNames.push_back(notification.name);
+				}
+			}
+		}
+		for (const std::string& varName : varNames) {
+			unsubscribe(pAddr, varName);
+		}
+	}
+
+	// Registers all device notifications again after the symbol table changed, dropping symbols/variables that disappeared
+	void refresh(PAmsAddr pAddr, const TwinCatSymbolTable& symbols) {
+		std::vector<TwinCatNotification> previous{};
+		{
+			std::lock_guard lock{ mutex };
+			for (const auto& [hUser, notification] : notifications) {
+				previous.push_back(notification);
+			}
+		}
+		for (const TwinCatNotification& notification : previous) {
+			unsubscribe(pAddr, notification.name);
+			auto it = symbols.find(notification.name);
+			if (it != symbols.end()) {
+				subscribe(pAddr, *it, notification.transMode, notification.cycleTime, notification.maxDelay, notification.idleTimeout);
+			}
+		}
+	}
+
+private:
+	// Called by ADS router for every received sample
+	static void __stdcall callback(AmsAddr*, AdsNotificationHeader* pNotification, ULONG hUser) {
+		std::lock_guard registryLock{ registryMutex };
+		auto it = registry.find(hUser >> 24);
+		if (it == registry.end()) return;
+		TwinCatNotificationCache& cache = *it->second;
+		std::lock_guard lock{ cache.mutex };
+		auto notification = cache.notifications.find(hUser);
+		if (notification == cache.notifications.end()) return;
+		notification->second.buffer.assign(pNotification->data, pNotification->data + pNotification->cbSampleSize);
+		notification->second.timestamp = pNotification->nTimeStamp;
+		notification->second.received = true;
+		notification->second.updated = std::chrono::steady_clock::now();
+	}
+
+	static inline std::mutex registryMutex;
+	static inline std::map<ULONG, TwinCatNotificationCache*> registry;
+	static inline ULONG nextId = 1;
+
+	ULONG id;
+	ULONG nextUser = 0;
+	std::mutex mutex;
+	std::map<ULONG, TwinCatNotification> notifications;
+	std::map<std::string, ULONG> users;
+};
+
+// Converts ADS timestamp (100ns intervals since 1601-01-01) to milliseconds since unix epoch
+inline int64_t getUnixTimestamp(int64_t timestamp) {
+	return (timestamp - 116444736000000000LL) / 10000;
+}
+
+// Returns version of symbol table, which is incremented by the PLC on every online change or download
+inline auto getSymbolVersion(PAmsAddr pAddr) {
+	UCHAR version{};
+	long nErr = AdsSyncReadReq(pAddr, ADSIGRP_SYM_VERSION, 0x0, sizeof(version), &version);
+	return std::make_pair(nErr, version);
+}
+
+// Interval in which symbol version and upload info are polled
+constexpr std::chrono::seconds SYMBOL_POLL_INTERVAL{ 5 };
+
+// Wakes up symbol table refresh as soon as the PLC notifies a new symbol version
+class TwinCatSymbolVersionWatch {
+public:
+	TwinCatSymbolVersionWatch() {
+		std::lock_guard lock{ registryMutex };
+		id = nextId++;
+		registry[id] = this;
+	}
+
+	~TwinCatSymbolVersionWatch() {
+		std::lock_guard lock{ registryMutex };
+		registry.erase(id);
+	}
+
+	// Registers device notification on symbol version, refresh falls back to polling if this fails
+	long start(PAmsAddr pAddr) {
+		AdsNotificationAttrib attrib{};
+		attrib.cbLength = sizeof(UCHAR);
+		attrib.nTransMode = ADSTRANS_SERVERONCHA;
+		return AdsSyncAddDeviceNotificationReq(pAddr, ADSIGRP_SYM_VERSION, 0x0, &attrib, &TwinCatSymbolVersionWatch::callback, id, &hNotification);
+	}
+
+	// Deletes device notification on symbol version
+	void stop(PAmsAddr pAddr) {
+		if (hNotification) AdsSyncDelDeviceNotificationReq(pAddr, hNotification);
+		hNotification = 0;
+	}
+
+	// Waits until a new symbol version was notified, timeout elapsed or stop was requested
+	void wait(std::stop_token stopToken, std::chrono::milliseconds timeout) {
+		std::unique_lock lock{ mutex };
+		changed.wait_for(lock, stopToken, timeout, [this] { return pending; });
+		pending = false;
+	}
+
+private:
+	// Called by ADS router whenever the symbol version changes
+	static void __stdcall callback(AmsAddr*, AdsNotificationHeader*, ULONG hUser) {
+		std::lock_guard registryLock{ registryMutex };
+		auto it = registry.find(hUser);
+		if (it == registry.end()) return;
+		std::lock_guard lock{ it->second->mutex };
+		it->second->pending = true;
+		it->second->changed.notify_all();
+	}
+
+	static inline std::mutex registryMutex;
+	static inline std::map<ULONG, TwinCatSymbolVersionWatch*> registry;
+	static inline ULONG nextId = 1;
+
+	ULONG id;
+	ULONG hNotification{};
+	std::mutex mutex;
+	std::condition_variable_any changed;
+	bool pending = false;
+};
+
+inline auto getUploadInfo(PAmsAddr pAddr) {
+	AdsSymbolUploadInfo2 tAdsSymbolUploadInfo;
+	long nErr = AdsSyncReadReq(pAddr, ADSIGRP_SYM_UPLOADINFO2, 0x0, sizeof(tAdsSymbolUploadInfo), &tAdsSymbolUploadInfo);
+	return std::make_pair(nErr, tAdsSymbolUploadInfo);
+}
+
+inline auto getSymbolUpload(PAmsAddr pAddr, AdsSymbolUploadInfo2 info) {
+	char* symbolUpload = new char[info.nSymSize];
+	long nErr = AdsSyncReadReq(pAddr, ADSIGRP_SYM_UPLOAD, 0, info.nSymSize, symbolUpload);
+	return std::make_pair(nErr, symbolUpload);
+}
+
+inline auto getDatatypeUpload(PAmsAddr pAddr, AdsSymbolUploadInfo2 info) {
+	char* dataUpload = new char[info.nDatatypeSize];
+	long nErr = AdsSyncReadReq(pAddr, ADSIGRP_SYM_DT_UPLOAD, 0, info.nDatatypeSize, dataUpload);
+	return std::make_pair(nErr, dataUpload);
+}
+
+inline bool isDatatype(PAdsDatatypeEntry datatype) {
+	if (datatype->flags == 0) return FALSE;
+	return (datatype->flags & ADSDATATYPEFLAG_DATATYPE) == ADSDATATYPEFLAG_DATATYPE;
+}
+
+inline bool isDataitem(PAdsDatatypeEntry datatype) {
+	if (datatype->flags == 0) return FALSE;
+	return (datatype->flags & ADSDATATYPEFLAG_DATAITEM) == ADSDATATYPEFLAG_DATAITEM;
+}
+
+inline TwinCatType getDatatype(PAdsDatatypeEntry datatypeEntry) {
+	std::string name{ PADSDATATYPENAME(datatypeEntry) };
+	std::string type{ PADSDATATYPETYPE(datatypeEntry) };
+	std::string comment{ PADSDATATYPECOMMENT(datatypeEntry) };
+	std::map<std::string, TwinCatType> subItems{};
+	for (UINT uiIndex = 0; uiIndex < datatypeEntry->subItems; uiIndex++)
+	{
+		PAdsDatatypeEntry subEntry = AdsDatatypeStructItem(datatypeEntry, uiIndex);
+		subItems[PADSDATATYPENAME(subEntry)] = getDatatype(subEntry);
+	}
+	ADS_UINT32		entryLength = datatypeEntry->entryLength;
+	ADS_UINT32		version = datatypeEntry->version;
+	ADS_UINT32		size = datatypeEntry->size;
+	ADS_UINT32		offs = datatypeEntry->offs;
+	ADS_UINT32		dataType = datatypeEntry->dataType;
+	ADS_UINT32		flags = datatypeEntry->flags;
+	ADS_UINT16		arrayDim = datatypeEntry->arrayDim;
+	std::vector<TwinCatArray> arrayVector{};
+	PAdsDatatypeArrayInfo arrayInfo = PADSDATATYPEARRAYINFO(datatypeEntry);
+	for (UINT uiIndex = 0; uiIndex < arrayDim; uiIndex++) {
+		unsigned long bound = arrayInfo->lBound;
+		unsigned long size = arrayInfo->elements;
+		arrayVector.push_back(TwinCatArray{bound, size});
+		arrayInfo++;
+	}
+	return TwinCatType{ name, type, comment, subItems, entryLength, version, size, offs, dataType, flags, arrayDim, arrayVector };
+}
+
+// Maximum nesting depth of datatypes, protects against cyclic declarations
+constexpr int MAX_DATATYPE_DEPTH = 64;
+
+// Appends layout of member to layout of struct
+inline void appendLayout(TwinCatLayout& layout, const TwinCatLayout& member, const std::string& name, ULONG offset) {
+	ULONG nodeBase = static_cast<ULONG>(layout.nodes.size());
+	ULONG dimBase = static_cast<ULONG>(layout.dims.size());
+	for (TwinCatLayoutNode node : member.nodes) {
+		node.end += nodeBase;
+		node.firstDim += dimBase;
+		layout.nodes.push_back(node);
+	}
+	layout.nodes[nodeBase].name = name;
+	layout.nodes[nodeBase].offset = offset;
+	layout.dims.insert(layout.dims.end(), member.dims.begin(), member.dims.end());
+}
+
+// Resolves datatype with given name into flattened layout, layouts of all datatypes it depends on are resolved and cached as well
+inline const TwinCatLayout& getDatatypeLayout(const std::map<std::string, TwinCatType>& datatypes, std::map<std::string, TwinCatLayout, std::less<>>& layouts, const std::string& name, int depth = 0) {
+	auto cached = layouts.find(name);
+	if (cached != layouts.end()) return cached->second;
+	TwinCatLayout layout{};
+	auto it = datatypes.find(name);
+	if (it == datatypes.end() || depth > MAX_DATATYPE_DEPTH) {
+		layout.nodes.push_back(TwinCatLayoutNode{ "", 0, 0, ADST_VOID, 0, 1, 0, 0 });
+	}
+	else {
+		const TwinCatType& datatype = it->second;
+		if (datatype.subItems.size() > 0) {
+			layout.nodes.push_back(TwinCatLayoutNode{ "", 0, datatype.size, ADST_BIGTYPE, static_cast<ULONG>(datatype.subItems.size()), 0, 0, 0 });
+			for (const auto& [key, value] : datatype.subItems) {
+				appendLayout(layout, getDatatypeLayout(datatypes, layouts, value.type, depth + 1), key, value.offs);
+			}
+			layout.nodes[0].end = static_cast<ULONG>(layout.nodes.size());
+		}
+		else if ((datatype.type == "" || datatype.dataType < ADST_MAXTYPES) && datatype.arrayVector.size() == 0) {
+			layout.nodes.push_back(TwinCatLayoutNode{ "", 0, datatype.size, datatype.dataType, 0, 1, 0, 0 });
+		}
+		else if (datatype.dataType == ADST_BIGTYPE && datatype.arrayVector.size() == 0) {
+			// Pointers and references are represented by their address
+			ULONG dataType = datatype.size == 4 ? static_cast<ULONG>(ADST_UINT32) : datatype.size == 8 ? static_cast<ULONG>(ADST_UINT64) : datatype.dataType;
+			layout.nodes.push_back(TwinCatLayoutNode{ "", 0, datatype.size, dataType, 0, 1, 0, 0 });
+		}
+		else if (datatype.arrayVector.size() > 0) {
+			// Dimensions of array are prepended to those of its element type, so ARRAY OF ARRAY becomes one multi-dimensional array
+			layout = getDatatypeLayout(datatypes, layouts, datatype.type, depth + 1);
+			std::vector<TwinCatLayoutDim> dims{};
+			for (const TwinCatArray& array : datatype.arrayVector) {
+				dims.push_back(TwinCatLayoutDim{ static_cast<ADS_INT32>(array.bound), static_cast<ULONG>(array.size), 0 });
+			}
+			auto elementDims = layout.getDims(0);
+			dims.insert(dims.end(), elementDims.begin(), elementDims.end());
+			ULONG stride = layout.nodes[0].size;
+			for (auto dim = dims.rbegin(); dim != dims.rend(); dim++) {
+				dim->stride = stride;
+				stride *= dim->elements;
+			}
+			layout.nodes[0].firstDim = static_cast<ULONG>(layout.dims.size());
+			layout.nodes[0].dimCount = static_cast<ULONG>(dims.size());
+			layout.dims.insert(layout.dims.end(), dims.begin(), dims.end());
+		}
+		else {
+			layout = getDatatypeLayout(datatypes, layouts, datatype.type, depth + 1);
+		}
+	}
+	return layouts[name] = std::move(layout);
+}
+
+// Resolves layouts of all datatypes used by symbols/variables
+inline auto getLayoutMap(const std::map<std::string, TwinCatType>& datatypes, const TwinCatSymbolTable& symbols) {
+	std::map<std::string, TwinCatLayout, std::less<>> layouts{};
+	for (const TwinCatVar& variable : symbols) {
+		if (!layouts.contains(variable.type)) getDatatypeLayout(datatypes, layouts, std::string(variable.type));
+	}
+	return layouts;
+}
+
+// Builds search index over symbols/variables
+inline auto getSymbolIndex(const TwinCatSymbolTable& symbols) {
+	TwinCatSymbolIndex index{};
+	index.keys.reserve(symbols.size());
+	for (const TwinCatVar& variable : symbols) {
+		index.keys.push_back(TwinCatSymbolKey{ toLowerCase(variable.name), toLowerCase(variable.type), toLowerCase(variable.comment), &variable });
+	}
+	// Names differing only in case keep their declared order
+	std::sort(index.keys.begin(), index.keys.end(), [](const TwinCatSymbolKey& a, const TwinCatSymbolKey& b) {
+		return std::tie(a.name, a.variable->name) < std::tie(b.name, b.variable->name);
+		});
+	return index;
+}
+
+// Parses all datatype declarations of given datatype upload
+inline std::map<std::string, TwinCatType> getDatatypeMap(const char* datatypeUpload, const AdsSymbolUploadInfo2& info) {
+	std::map<std::string, TwinCatType> datatypes{};
+	ULONG offset = 0;
+	for (UINT uiIndex = 0; uiIndex < info.nDatatypes && offset + sizeof(AdsDatatypeEntry) <= info.nDatatypeSize; uiIndex++)
+	{
+		PAdsDatatypeEntry datatypeEntry = (PAdsDatatypeEntry)(datatypeUpload + offset);
+		if (datatypeEntry->entryLength == 0) break;
+		std::string name{ PADSDATATYPENAME(datatypeEntry) };
+		datatypes[name] = getDatatype(datatypeEntry);
+		offset += datatypeEntry->entryLength;
+	}
+	return datatypes;
+}
+
+// Returns all datatype declarations
+inline auto getDatatypeMap(PAmsAddr pAddr, AdsSymbolUploadInfo2 info) {
+	std::map<std::string, TwinCatType> datatypes{};
+	auto [nErr, datatypeUpload] = getDatatypeUpload(pAddr, info);
+	if (!nErr) datatypes = getDatatypeMap(datatypeUpload, info);
+	delete[] datatypeUpload;
+	return std::make_pair(nErr, datatypes);
+}
+
+// Indexes all symbol/variable declarations of given symbol upload, which the returned table takes ownership of
+inline TwinCatSymbolTable getSymbolTable(std::shared_ptr<const char[]> symbolUpload, const AdsSymbolUploadInfo2& info) {
+	std::vector<TwinCatVar> declarations{};
+	declarations.reserve(info.nSymbols);
+	ULONG offset = 0;
+	for (UINT uiIndex = 0; uiIndex < info.nSymbols && offset + sizeof(AdsSymbolEntry) <= info.nSymSize; uiIndex++)
+	{
+		const AdsSymbolEntry* symbolEntry = reinterpret_cast<const AdsSymbolEntry*>(symbolUpload.get() + offset);
+		if (symbolEntry->entryLength == 0 || offset + symbolEntry->entryLength > info.nSymSize) break;
+		// Name, type and comment follow the entry, each of them null terminated
+		if (sizeof(AdsSymbolEntry) + symbolEntry->nameLength + symbolEntry->typeLength + symbolEntry->commentLength + 3 > symbolEntry->entryLength) break;
+		const char* name = reinterpret_cast<const char*>(symbolEntry + 1);
+		const char* type = name + symbolEntry->nameLength + 1;
+		const char* comment = type + symbolEntry->typeLength + 1;
+		declarations.push_back(TwinCatVar{ { name, symbolEntry->nameLength }, symbolEntry->iGroup, symbolEntry->iOffs, symbolEntry->size, { type, symbolEntry->typeLength }, { comment, symbolEntry->commentLength } });
+		offset += symbolEntry->entryLength;
+	}
+	return TwinCatSymbolTable{ std::move(symbolUpload), std::move(declarations) };
+}
+
+// Returns all symbol/variable declarations
+inline auto getSymbolTable(PAmsAddr pAddr, AdsSymbolUploadInfo2 info) {
+	auto [nErr, pchSymbols] = getSymbolUpload(pAddr, info);
+	std::shared_ptr<const char[]> symbolUpload{ pchSymbols };
+	if (nErr) return std::make_pair(nErr, TwinCatSymbolTable{});
+	return std::make_pair(nErr, getSymbolTable(std::move(symbolUpload), info));
+}
+
+// Resolves symbol/variable name followed by struct members and array indices, e.g. "MAIN.fbAxis.stStatus.nError" or "MAIN.aMatrix[1,2]",
+// to index group, offset and type of the member using the datatype tree. Returns nullopt if path matches no member.
+inline std::optional<TwinCatMember> findMember(const TwinCatSnapshot& snapshot, const std::string& path) {
+	// Names of symbols/variables contain dots themselves, so the longest declared name is used
+	const TwinCatVar* variable = nullptr;
+	size_t pos = path.find_last_of(".[");
+	for (; pos != std::string::npos && pos > 0; pos = path.find_last_of(".[", pos - 1)) {
+		if ((variable = snapshot.findSymbol(path.substr(0, pos)))) break;
+	}
+	if (!variable) return std::nullopt;
+	TwinCatMember member{ *variable, path };
+	int aliases = 0;
+	while (pos < path.size()) {
+		auto it = snapshot.datatypes.find(std::string(member.type));
+		if (it == snapshot.datatypes.end()) return std::nullopt;
+		const TwinCatType& datatype = it->second;
+		if (datatype.subItems.empty() && datatype.arrayVector.empty() && datatype.type != "" && datatype.dataType >= ADST_MAXTYPES && datatype.dataType != ADST_BIGTYPE) {
+			if (++aliases > MAX_DATATYPE_DEPTH) return std::nullopt;
+			member.type = datatype.type;
+		}
+		else if (path[pos] == '.') {
+			size_t end = path.find_first_of(".[", pos + 1);
+			auto item = datatype.subItems.find(path.substr(pos + 1, end == std::string::npos ? std::string::npos : end - pos - 1));
+			if (item == datatype.subItems.end()) return std::nullopt;
+			member.indexOffset += item->second.offs;
+			member.size = item->second.size;
+			member.type = item->second.type;
+			member.comment = item->second.comment;
+			pos = end;
+		}
+		else if (path[pos] == '[') {
+			size_t end = path.find(']', pos);
+			if (end == std::string::npos || datatype.arrayVector.empty()) return std::nullopt;
+			std::vector<std::string> indices = splitPath(path.substr(pos + 1, end - pos - 1), ",");
+			if (indices.size() != datatype.arrayVector.size()) return std::nullopt;
+			ULONG elements = 1;
+			for (const TwinCatArray& array : datatype.arrayVector) {
+				elements *= static_cast<ULONG>(array.size);
+			}
+			if (elements == 0) return std::nullopt;
+			// Last dimension is the innermost, its stride is the element size
+			ULONG stride = datatype.size / elements;
+			member.size = stride;
+			for (size_t dim = indices.size(); dim-- > 0;) {
+				const std::string& indexStr = indices[dim];
+				int64_t lower = static_cast<ADS_INT32>(datatype.arrayVector[dim].bound);
+				int64_t index{};
+				if (std::from_chars(indexStr.data(), indexStr.data() + indexStr.size(), index).ptr != indexStr.data() + indexStr.size() || indexStr.empty()) return std::nullopt;
+				if (index < lower || index >= lower + static_cast<int64_t>(datatype.arrayVector[dim].size)) return std::nullopt;
+				member.indexOffset += static_cast<ULONG>(index - lower) * stride;
+				stride *= static_cast<ULONG>(datatype.arrayVector[dim].size);
+			}
+			member.type = datatype.type;
+			pos = end + 1;
+		}
+		else {
+			return std::nullopt;
+		}
+	}
+	return member;
+}
+
+// Returns declared symbol/variable with given name, otherwise resolves name as member path into member, nullptr if neither exists
+inline const TwinCatVar* findVariable(const TwinCatSnapshot& snapshot, const std::string& name, std::optional<TwinCatMember>& member) {
+	if (const TwinCatVar* variable = snapshot.findSymbol(name)) return variable;
+	member = findMember(snapshot, name);
+	return member ? &*member : nullptr;
+}
+
+// Default size of the chunks a streaming TwinCatJSONWriter hands to its sink
+constexpr size_t JSON_CHUNK_SIZE = 64 * 1024;
+
+// Append-only output buffer for JSON text shared by all recursion levels of the decoders.
+// With a sink, full chunks are handed over as soon as they are written, so large values are never held as a whole.
+class TwinCatJSONWriter {
+public:
+	TwinCatJSONWriter() = default;
+
+	explicit TwinCatJSONWriter(std::function<bool(const char*, size_t)> sink, size_t chunkSize = JSON_CHUNK_SIZE) : sink(std::move(sink)), chunkSize(chunkSize) {
+		out.reserve(chunkSize);
+	}
+
+	void append(std::string_view text) {
+		out.append(text);
+		check();
+	}
+
+	void append(char c) {
+		out.push_back(c);
+		check();
+	}
+
+	void appendNumber(auto value) {
+		appendJSONNumber(out, value);
+		check();
+	}
+
+	// Hands buffered text to sink, returns false once the sink failed
+	bool flush() {
+		if (sink && ok && !out.empty()) ok = sink(out.data(), out.size());
+		if (sink) out.clear();
+		return ok;
+	}
+
+	// Text written so far, without sink the whole JSON text
+	std::string& str() {
+		return out;
+	}
+
+private:
+	void check() {
+		if (sink && out.size() >= chunkSize) flush();
+	}
+
+	std::string out;
+	std::function<bool(const char*, size_t)> sink;
+	size_t chunkSize = JSON_CHUNK_SIZE;
+	bool ok = true;
+};
+
+// Number of symbols/variables written at once by streamed listings
+constexpr size_t LISTING_CHUNK_SYMBOLS = 256;
+
+// Writes symbol/variable as member "name":{...} of a JSON object
+inline void writeSymbolEntry(const TwinCatVar& variable, TwinCatJSONWriter& writer, bool first) {
+	if (!first) writer.append(',');
+	writer.append('"');
+	writer.append(variable.name);
+	writer.append("\":");
+	writer.append(variable.str());
+}
+
+// Writes symbols/variables starting at it as members "name":{...} of a JSON object, at most limit of them.
+// Returns iterator to the first symbol/variable not written.
+inline auto writeSymbolEntries(TwinCatSymbolTable::const_iterator it, TwinCatSymbolTable::const_iterator end, size_t limit, TwinCatJSONWriter& writer, bool first = true) {
+	for (size_t count = 0; it != end && count < limit; ++it, ++count) {
+		writeSymbolEntry(*it, writer, first);
+		first = false;
+	}
+	return it;
+}
+
+// Returns page of at most limit symbols/variables in name order following the one named after, or from the first one if after is empty,
+// as {"Symbols":{...},"Next":name}. Next is the cursor of the following page, null on the last page.
+inline std::string getSymbolPage(const TwinCatSnapshot& snapshot, const std::string& after, size_t limit) {
+	auto first = after.empty() ? snapshot.symbols.begin() : snapshot.symbols.upper_bound(after);
+	TwinCatJSONWriter writer{};
+	writer.append("{\"Symbols\":{");
+	auto next = writeSymbolEntries(first, snapshot.symbols.end(), limit, writer);
+	writer.append("},\"Next\":");
+	if (next != snapshot.symbols.end() && next != first) {
+		writer.append('"');
+		writer.append(std::prev(next)->name);
+		writer.append('"');
+	}
+	else {
+		writer.append("null");
+	}
+	writer.append('}');
+	return std::move(writer.str());
+}
+
+// Criteria of symbol/variable search, all given ones must match. Matching is case insensitive.
+struct TwinCatSymbolQuery {
+	// Start of name
+	std::string prefix{};
+	// Glob pattern the whole name must match
+	std::string match{};
+	// Glob pattern the whole type name must match
+	std::string type{};
+	// Text the comment contains
+	std::string comment{};
+};
+
+// Returns page of at most limit symbols/variables matching query in case insensitive name order following the one named after,
+// as {"Symbols":{...},"Next":name} like getSymbolPage
+inline std::string findSymbols(const TwinCatSnapshot& snapshot, const TwinCatSymbolQuery& query, const std::string& after, size_t limit) {
+	std::string prefix = toLowerCase(query.prefix);
+	std::string match = toLowerCase(query.match);
+	std::string type = toLowerCase(query.type);
+	std::string comment = toLowerCase(query.comment);
+	// Literal start of the name pattern narrows the searched range like a prefix does
+	std::string_view literal = std::string_view(match).substr(0, match.find_first_of("*?"));
+	bool disjoint = !literal.starts_with(prefix) && !std::string_view(prefix).starts_with(literal);
+	if (literal.size() > prefix.size()) prefix = literal;
+	auto keys = disjoint ? std::span<const TwinCatSymbolKey>{} : snapshot.index.withPrefix(prefix);
+	if (!after.empty()) {
+		std::string lowerAfter = toLowerCase(after);
+		auto first = std::partition_point(keys.begin(), keys.end(), [&](const TwinCatSymbolKey& key) {
+			return std::tie(key.name, key.variable->name) <= std::tie(lowerAfter, after);
+			});
+		keys = keys.subspan(first - keys.begin());
+	}
+	TwinCatJSONWriter writer{};
+	writer.append("{\"Symbols\":{");
+	size_t count = 0;
+	const TwinCatVar* last = nullptr;
+	bool more = false;
+	for (const TwinCatSymbolKey& key : keys) {
+		if (!match.empty() && !matchGlob(match, key.name)) continue;
+		if (!type.empty() && !matchGlob(type, key.type)) continue;
+		if (!comment.empty() && key.comment.find(comment) == std::string::npos) continue;
+		if (count == limit) {
+			more = true;
+			break;
+		}
+		writeSymbolEntry(*key.variable, writer, count++ == 0);
+		last = key.variable;
+	}
+	writer.append("},\"Next\":");
+	if (more && last) {
+		writer.append('"');
+		writer.append(last->name);
+		writer.append('"');
+	}
+	else {
+		writer.append("null");
+	}
+	writer.append('}');
+	return std::move(writer.str());
+}
+
+inline long writeVariableJSONValue(const TwinCatLayout& layout, ULONG index, std::span<const char> buffer, ULONG offset, TwinCatJSONWriter& writer, bool aryItem = false);
+
+// Number of array elements loaded and formatted at once by the fast path for arrays of primitives
+constexpr ULONG JSON_BATCH_ELEMENTS = 64;
+
+#ifdef ADSBRIDGE_SSE2_SUPPORT
+// Returns the eight decimal digits of value below 10^8 in 16 bit lanes, most significant first. The value is split into
+// abcd and efgh, both are spread over four lanes and divided by 10^3, 10^2, 10^1 and 10^0 at once with fixed point
+// reciprocals, then every lane subtracts ten times its left neighbour.
+inline __m128i getDecimalDigitsSSE2(uint32_t value) {
+	// 0xd1b71759 / 2^45 is 1 / 10000 rounded up, exact for values below 10^8
+	const __m128i abcdefgh = _mm_cvtsi32_si128(static_cast<int>(value));
+	const __m128i abcd = _mm_srli_epi64(_mm_mul_epu32(abcdefgh, _mm_set1_epi32(static_cast<int>(0xd1b71759))), 45);
+	const __m128i efgh = _mm_sub_epi32(abcdefgh, _mm_mul_epu32(abcd, _mm_set1_epi32(10000)));
+	// [abcd * 4 x4, efgh * 4 x4], the factor 4 keeps precision of the reciprocals
+	const __m128i v1 = _mm_slli_epi64(_mm_unpacklo_epi16(abcd, efgh), 2);
+	const __m128i v2 = _mm_unpacklo_epi16(v1, v1);
+	const __m128i v3 = _mm_unpacklo_epi32(v2, v2);
+	// [a, ab, abc, abcd, e, ef, efg, efgh]
+	const __m128i v4 = _mm_mulhi_epu16(v3, _mm_setr_epi16(8389, 5243, 13108, -32768, 8389, 5243, 13108, -32768));
+	const __m128i v5 = _mm_mulhi_epu16(v4, _mm_setr_epi16(1 << 7, 1 << 11, 1 << 13, -32768, 1 << 7, 1 << 11, 1 << 13, -32768));
+	// [a, b, c, d, e, f, g, h]
+	const __m128i v6 = _mm_slli_epi64(_mm_mullo_epi16(v5, _mm_set1_epi16(10)), 16);
+	return _mm_sub_epi16(v5, v6);
+}
+
+// Writes unsigned value as decimal text at pos, sixteen digits are generated at once. Returns end of written characters.
+inline char* formatUnsignedSSE2(char* pos, uint64_t value) {
+	constexpr uint64_t TEN_8 = 100000000;
+	constexpr uint64_t TEN_16 = TEN_8 * TEN_8;
+	// Values of 17 to 20 digits write the leading ones first, the remaining sixteen keep their zeros
+	bool full = value >= TEN_16;
+	if (full) {
+		pos = formatUnsignedSSE2(pos, value / TEN_16);
+		value %= TEN_16;
+	}
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i high = value >= TEN_8 ? getDecimalDigitsSSE2(static_cast<uint32_t>(value / TEN_8)) : zero;
+	const __m128i digits = _mm_packus_epi16(high, getDecimalDigitsSSE2(static_cast<uint32_t>(value % TEN_8)));
+	char chars[16];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(chars), _mm_add_epi8(digits, _mm_set1_epi8('0')));
+	// Leading zeros are found with one compare, the last digit is always written
+	int zeros = std::countr_one(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(digits, zero))));
+	int leading = full ? 0 : std::min(zeros, 15);
+	return std::copy(chars + leading, chars + sizeof(chars), pos);
+}
+
+// Writes integer as decimal text at pos like std::to_chars, returns end of written characters
+template <typename T>
+char* formatIntegerSSE2(char* pos, T value) {
+	if constexpr (std::is_signed_v<T>) {
+		if (value < 0) {
+			*pos++ = '-';
+			return formatUnsignedSSE2(pos, 0 - static_cast<uint64_t>(value));
+		}
+	}
+	return formatUnsignedSSE2(pos, static_cast<uint64_t>(value));
+}
+#endif
+
+// Writes count consecutive elements of primitive type T as comma separated JSON values. The whole run is bounds checked once,
+// every batch is loaded with one copy into a typed array and formatted into one stack buffer appended at once. Integer digits
+// are generated with SSE2 where available, otherwise and for floating point numbers with std::to_chars.
+// Returns false without writing anything if the run exceeds the buffer.
+template <typename T>
+bool writePrimitiveArray(std::span<const char> buffer, ULONG offset, ULONG count, TwinCatJSONWriter& writer) {
+	// BOOL is loaded as byte, any value but 0 is true
+	using Element = std::conditional_t<std::is_same_v<T, bool>, UINT8, T>;
+	if (static_cast<uint64_t>(offset) + static_cast<uint64_t>(count) * sizeof(Element) > buffer.size()) return false;
+	Element values[JSON_BATCH_ELEMENTS];
+	char chars[JSON_BATCH_ELEMENTS * 32];
+	for (ULONG first = 0; first < count; first += JSON_BATCH_ELEMENTS) {
+		ULONG batch = std::min(count - first, JSON_BATCH_ELEMENTS);
+		memcpy(values, buffer.data() + offset + first * sizeof(Element), batch * sizeof(Element));
+		char* pos = chars;
+		for (ULONG i = 0; i < batch; i++) {
+			if (first + i > 0) {
+				*pos++ = ',';
+			}
+			if constexpr (std::is_same_v<T, bool>) {
+				std::string_view value = values[i] ? "true" : "false";
+				pos = std::copy(value.begin(), value.end(), pos);
+			}
+#ifdef ADSBRIDGE_SSE2_SUPPORT
+			else if constexpr (std::is_integral_v<Element>) {
+				pos = formatIntegerSSE2(pos, values[i]);
+			}
+#endif
+			else if constexpr (std::is_floating_point_v<Element>) {
+				if (std::isfinite(values[i])) {
+					pos = std::to_chars(pos, chars + sizeof(chars), values[i]).ptr;
+				}
+				else {
+					pos = std::copy_n("null", 4, pos);
+				}
+			}
+			else {
+				pos = std::to_chars(pos, chars + sizeof(chars), +values[i]).ptr;
+			}
+		}
+		writer.append(std::string_view(chars, pos - chars));
+	}
+	return true;
+}
+
+// Writes consecutive array elements of a primitive node in batches, returns false if node is no primitive number or BOOL
+// or the elements exceed the buffer, so the caller decodes them one by one
+inline bool writePrimitiveArray(const TwinCatLayoutNode& node, std::span<const char> buffer, ULONG offset, ULONG count, TwinCatJSONWriter& writer) {
+	if (node.subItems > 0) return false;
+	auto write = [&](auto data) {
+		return node.size == sizeof(data) && writePrimitiveArray<decltype(data)>(buffer, offset, count, writer);
+	};
+	switch ((ADSDATATYPE)node.dataType)
+	{
+	case ADST_BIT:
+		return write(bool{});
+	case ADST_INT8:
+		return write(INT8{});
+	case ADST_INT16:
+		return write(INT16{});
+	case ADST_INT32:
+		return write(INT32{});
+	case ADST_INT64:
+		return write(INT64{});
+	case ADST_UINT8:
+		return write(UINT8{});
+	case ADST_UINT16:
+		return write(UINT16{});
+	case ADST_UINT32:
+		return write(UINT32{});
+	case ADST_UINT64:
+		return write(UINT64{});
+	case ADST_REAL32:
+		return write(float{});
+	case ADST_REAL64:
+		return write(double{});
+	default:
+		return false;
+	}
+}
+
+
+// Adapted from: https://github.com/jisotalo/ads-client/blob/master/src/ads-client.js
+inline long parseArray(const TwinCatLayout& layout, ULONG index, std::span<const char> buffer, ULONG offset, TwinCatJSONWriter& writer, ULONG dim) {
+	long nErr{};
+	auto dims = layout.getDims(index);
+	writer.append('[');
+	// Innermost dimension of primitives is contiguous and formatted in batches
+	if ((dim + 1) == dims.size() && writePrimitiveArray(layout.nodes[index], buffer, offset, dims[dim].elements, writer)) {
+		writer.append(']');
+		return nErr;
+	}
+	for (ULONG i = 0; i < dims[dim].elements; i++) {
+		if (i > 0) {
+			writer.append(',');
+		}
+		ULONG elementOffset = offset + i * dims[dim].stride;
+		long err = (dim + 1) < dims.size()
+			? parseArray(layout, index, buffer, elementOffset, writer, dim + 1)
+			: writeVariableJSONValue(layout, index, buffer, elementOffset, writer, true);
+		if (err) nErr = err;
+	}
+	writer.append(']');
+	return nErr;
+}
+
+// Writes value of layout node as JSON text, values which cannot be decoded are written as null and their error is returned
+inline long writeVariableJSONValue(const TwinCatLayout& layout, ULONG index, std::span<const char> buffer, ULONG offset, TwinCatJSONWriter& writer, bool aryItem) {
+	long nErr{};
+	const TwinCatLayoutNode& node = layout.nodes[index];
+	auto writeNumber = [&](auto data) {
+		auto [err, value] = readBufferOffset(buffer, offset, data, nErr);
+		if (err) {
+			writer.append("null");
+		}
+		else {
+			writer.appendNumber(value);
+		}
+	};
+	if ((node.dimCount == 0 || aryItem) && node.subItems > 0) {
+		writer.append('{');
+		for (ULONG member = index + 1; member < node.end; member = layout.nodes[member].end) {
+			if (member > index + 1) {
+				writer.append(',');
+			}
+			writer.append('"');
+			writer.append(layout.nodes[member].name);
+			writer.append("\":");
+			long err = writeVariableJSONValue(layout, member, buffer, offset + layout.nodes[member].offset, writer);
+			if (err) nErr = err;
+		}
+		writer.append('}');
+	}
+	else if (node.dimCount > 0 && !aryItem) {
+		nErr = parseArray(layout, index, buffer, offset, writer, 0);
+	}
+	else {
+		switch ((ADSDATATYPE)node.dataType)
+		{
+		case ADST_VOID:
+			writer.append("null");
+			break;
+		case ADST_BIT:
+		{
+			auto [err, data] = readBufferOffset(buffer, offset, bool{}, nErr);
+			writer.append(err ? "null" : data ? "true" : "false");
+		}
+		break;
+		case ADST_INT8:
+			writeNumber(INT8{});
+			break;
+		case ADST_INT16:
+			writeNumber(INT16{});
+			break;
+		case ADST_INT32:
+			writeNumber(INT32{});
+			break;
+		case ADST_INT64:
+			writeNumber(INT64{});
+			break;
+		case ADST_UINT8:
+			writeNumber(UINT8{});
+			break;
+		case ADST_UINT16:
+			writeNumber(UINT16{});
+			break;
+		case ADST_UINT32:
+			writeNumber(UINT32{});
+			break;
+		case ADST_UINT64:
+			writeNumber(UINT64{});
+			break;
+		case ADST_REAL32:
+			writeNumber(float{});
+			break;
+		case ADST_REAL64:
+			writeNumber(double{});
+			break;
+		case ADST_STRING:
+			if (offset + node.size > buffer.size()) {
+				nErr = ADSERR_DEVICE_INVALIDSIZE;
+				writer.append("null");
+			}
+			else {
+				const char* pData = buffer.data() + offset;
+				std::string extendedValue{ pData, strnlen(pData, node.size) };
+				writer.append(nlohmann::json(extendedValue).dump(-1, ' ', false, nlohmann::json::error_handler_t::replace));
+			}
+			break;
+		default:
+			nErr = ADSERR_DEVICE_INVALIDDATA;
+			writer.append("null");
+			break;
+		}
+	}
+	return nErr;
+}
+
+// Decodes value of layout node and returns JSON string representation
+inline std::pair<long, std::string> getVariableJSONValue(const TwinCatLayout& layout, ULONG index, std::span<const char> buffer, ULONG offset, bool aryItem = false) {
+	TwinCatJSONWriter writer{};
+	long nErr = writeVariableJSONValue(layout, index, buffer, offset, writer, aryItem);
+	return std::pair(nErr, std::move(writer.str()));
+}
+
+inline std::pair<long, nlohmann::json> getVariableJSONDocument(const TwinCatLayout& layout, ULONG index, std::span<const char> buffer, ULONG offset, bool aryItem = false);
+
+// Decodes array elements into nested JSON arrays, one per dimension
+inline std::pair<long, nlohmann::json> parseArrayDocument(const TwinCatLayout& layout, ULONG index, std::span<const char> buffer, ULONG offset, ULONG dim) {
+	long nErr{};
+	auto dims = layout.getDims(index);
+	nlohmann::json document = nlohmann::json::array();
+	for (ULONG i = 0; i < dims[dim].elements; i++) {
+		ULONG elementOffset = offset + i * dims[dim].stride;
+		auto [err, value] = (dim + 1) < dims.size()
+			? parseArrayDocument(layout, index, buffer, elementOffset, dim + 1)
+			: getVariableJSONDocument(layout, index, buffer, elementOffset, true);
+		if (err) nErr = err;
+		document.push_back(std::move(value));
+	}
+	return std::make_pair(nErr, std::move(document));
+}
+
+// Decodes value like getVariableJSONValue but into a JSON document instead of text,
+// used for binary encodings (MessagePack, CBOR) which skip the text representation
+inline std::pair<long, nlohmann::json> getVariableJSONDocument(const TwinCatLayout& layout, ULONG index, std::span<const char> buffer, ULONG offset, bool aryItem) {
+	long nErr{};
+	const TwinCatLayoutNode& node = layout.nodes[index];
+	nlohmann::json document{};
+	auto readValue = [&](auto data) {
+		auto [err, value] = readBufferOffset(buffer, offset, data, nErr);
+		// NaN and infinity are null like in JSON text, so every encoding holds the same values
+		if constexpr (std::is_floating_point_v<decltype(data)>) {
+			if (!err && !std::isfinite(value)) return nlohmann::json{};
+		}
+		return err ? nlohmann::json{} : nlohmann::json(value);
+	};
+	if ((node.dimCount == 0 || aryItem) && node.subItems > 0) {
+		document = nlohmann::json::object();
+		for (ULONG member = index + 1; member < node.end; member = layout.nodes[member].end) {
+			auto [err, value] = getVariableJSONDocument(layout, member, buffer, offset + layout.nodes[member].offset);
+			if (err) nErr = err;
+			document[layout.nodes[member].name] = std::move(value);
+		}
+	}
+	else if (node.dimCount > 0 && !aryItem) {
+		std::tie(nErr, document) = parseArrayDocument(layout, index, buffer, offset, 0);
+	}
+	else {
+		switch ((ADSDATATYPE)node.dataType)
+		{
+		case ADST_VOID:
+			break;
+		case ADST_BIT:
+			document = readValue(bool{});
+			break;
+		case ADST_INT8:
+			document = readValue(INT8{});
+			break;
+		case ADST_INT16:
+			document = readValue(INT16{});
+			break;
+		case ADST_INT32:
+			document = readValue(INT32{});
+			break;
+		case ADST_INT64:
+			document = readValue(INT64{});
+			break;
+		case ADST_UINT8:
+			document = readValue(UINT8{});
+			break;
+		case ADST_UINT16:
+			document = readValue(UINT16{});
+			break;
+		case ADST_UINT32:
+			document = readValue(UINT32{});
+			break;
+		case ADST_UINT64:
+			document = readValue(UINT64{});
+			break;
+		case ADST_REAL32:
+			document = readValue(float{});
+			break;
+		case ADST_REAL64:
+			document = readValue(double{});
+			break;
+		case ADST_STRING:
+			if (offset + node.size > buffer.size()) {
+				nErr = ADSERR_DEVICE_INVALIDSIZE;
+			}
+			else {
+				const char* pData = buffer.data() + offset;
+				document = std::string{ pData, strnlen(pData, node.size) };
+			}
+			break;
+		default:
+			nErr = ADSERR_DEVICE_INVALIDDATA;
+			break;
+		}
+	}
+	return std::make_pair(nErr, std::move(document));
+}
+
+// Decodes value of symbol/variable from buffer holding its raw bytes into a JSON document
+inline auto getVariableJSONDocument(const TwinCatSnapshot& snapshot, const TwinCatVar& variable, std::span<const char> buffer) {
+	return getVariableJSONDocument(snapshot.findLayout(variable), 0, buffer, 0);
+}
+
+// Decodes value of symbol/variable from buffer holding its raw bytes and returns JSON string representation
+inline auto getVariableJSONValue(const TwinCatSnapshot& snapshot, const TwinCatVar& variable, std::span<const char> buffer) {
+	return getVariableJSONValue(snapshot.findLayout(variable), 0, buffer, 0);
+}
+
+// Reads value of symbol/variable with a single ADS request, optionally through its cached handle, and returns JSON string representation
+inline auto getVariableJSONValue(PAmsAddr pAddr, const TwinCatSnapshot& snapshot, const TwinCatVar& variable, TwinCatHandleCache* handles = nullptr) {
+	auto [nErr, buffer] = handles ? readVariableBufferByHandle(pAddr, *handles, variable) : readVariableBuffer(pAddr, variable);
+	if (nErr) return std::pair(nErr, std::string{});
+	return getVariableJSONValue(snapshot, variable, buffer);
+}
+
+// Member of symbol/variable selected by a dotted path relative to it, e.g. "axis.status.error"
+struct TwinCatField {
+	std::vector<std::string> path;
+	// Layout node of member
+	ULONG index;
+	// Offset relative to start of symbol/variable
+	ULONG offset;
+	// Size of member including all array elements
+	ULONG size;
+};
+
+// Resolves dotted member path against layout, returns nullopt if a member does not exist
+inline std::optional<TwinCatField> findLayoutField(const TwinCatLayout& layout, const std::string& path) {
+	TwinCatField field{ splitPath(path, "."), 0, 0, 0 };
+	for (const std::string& name : field.path) {
+		const TwinCatLayoutNode& node = layout.nodes[field.index];
+		if (node.dimCount > 0 || node.subItems == 0) return std::nullopt;
+		ULONG member = field.index + 1;
+		while (member < node.end && layout.nodes[member].name != name) {
+			member = layout.nodes[member].end;
+		}
+		if (member >= node.end) return std::nullopt;
+		field.index = member;
+		field.offset += layout.nodes[member].offset;
+	}
+	auto dims = layout.getDims(field.index);
+	field.size = dims.empty() ? layout.nodes[field.index].size : dims[0].elements * dims[0].stride;
+	return field;
+}
+
+// Resolves dotted member paths against layout, sorted by path and without members contained in another requested member,
+// returns nullopt if a member does not exist
+inline std::optional<std::vector<TwinCatField>> getLayoutFields(const TwinCatLayout& layout, const std::vector<std::string>& paths) {
+	std::vector<TwinCatField> fields{};
+	for (const std::string& path : paths) {
+		auto field = findLayoutField(layout, path);
+		if (!field) return std::nullopt;
+		fields.push_back(std::move(*field));
+	}
+	std::sort(fields.begin(), fields.end(), [](const TwinCatField& a, const TwinCatField& b) {
+		return a.path < b.path;
+	});
+	// A member sorts directly before all members nested in it
+	std::vector<TwinCatField> unique{};
+	for (TwinCatField& field : fields) {
+		if (!unique.empty() && field.path.size() >= unique.back().path.size() && std::equal(unique.back().path.begin(), unique.back().path.end(), field.path.begin())) continue;
+		unique.push_back(std::move(field));
+	}
+	return unique;
+}
+
+// Decodes given members from buffers holding their raw bytes and returns JSON object nesting them along their paths
+inline std::pair<long, std::string> getFieldsJSONValue(const TwinCatLayout& layout, const std::vector<TwinCatField>& fields, const std::vector<std::span<const char>>& buffers) {
+	long nErr{};
+	TwinCatJSONWriter writer{};
+	writer.append('{');
+	// Names of objects opened for the path of the previous member
+	std::vector<std::string> open{};
+	for (size_t i = 0; i < fields.size(); i++) {
+		const std::vector<std::string>& path = fields[i].path;
+		size_t common = 0;
+		while (common < open.size() && common + 1 < path.size() && open[common] == path[common]) {
+			common++;
+		}
+		for (; open.size() > common; open.pop_back()) {
+			writer.append('}');
+		}
+		if (i > 0) {
+			writer.append(',');
+		}
+		for (size_t depth = common; depth + 1 < path.size(); depth++) {
+			writer.append('"');
+			writer.append(path[depth]);
+			writer.append("\":{");
+			open.push_back(path[depth]);
+		}
+		writer.append('"');
+		writer.append(path.back());
+		writer.append("\":");
+		long err = writeVariableJSONValue(layout, fields[i].index, buffers[i], 0, writer);
+		if (err) nErr = err;
+	}
+	for (; !open.empty(); open.pop_back()) {
+		writer.append('}');
+	}
+	writer.append('}');
+	return std::pair(nErr, std::move(writer.str()));
+}
+
+// Decodes given members from buffer holding the raw bytes of the whole symbol/variable
+inline auto getFieldsJSONValue(const TwinCatSnapshot& snapshot, const TwinCatVar& variable, const std::vector<TwinCatField>& fields, std::span<const char> buffer) {
+	std::vector<std::span<const char>> buffers{};
+	for (const TwinCatField& field : fields) {
+		buffers.push_back(field.offset + field.size <= buffer.size() ? buffer.subspan(field.offset, field.size) : std::span<const char>{});
+	}
+	return getFieldsJSONValue(snapshot.findLayout(variable), fields, buffers);
+}
+
+// Reads only given members of symbol/variable, members less than maxGap bytes apart are read as one range
+inline auto getFieldsJSONValue(PAmsAddr pAddr, const TwinCatSnapshot& snapshot, const TwinCatVar& variable, const std::vector<TwinCatField>& fields, ULONG maxGap = MAX_MERGE_GAP) {
+	std::vector<TwinCatRange> ranges{};
+	for (const TwinCatField& field : fields) {
+		ranges.push_back(TwinCatRange{ variable.indexGroup, variable.indexOffset + field.offset, field.size });
+	}
+	auto results = readMergedBuffers(pAddr, ranges, maxGap);
+	std::vector<std::span<const char>> buffers{};
+	for (const auto& [nErr, buffer] : results) {
+		if (nErr) return std::pair(nErr, std::string{});
+		buffers.push_back(buffer);
+	}
+	return getFieldsJSONValue(snapshot.findLayout(variable), fields, buffers);
+}
+
+// Elements of an array node selected per dimension, positions are zero based and end is exclusive
+struct TwinCatSlice {
+	// Layout node of array
+	ULONG index;
+	std::vector<std::pair<ULONG, ULONG>> ranges;
+	// Offset of first selected element relative to start of array
+	ULONG offset;
+	// Bytes from first to end of last selected element
+	ULONG size;
+	// True if no unselected element lies between first and last selected element
+	bool contiguous;
+};
+
+// Parses array index range per dimension, e.g. "99900:99999" or "0:1,2", bounds are inclusive and declared array indices,
+// missing bounds or dimensions select all elements. Returns nullopt if node is no array or range is invalid.
+inline std::optional<TwinCatSlice> getLayoutSlice(const TwinCatLayout& layout, ULONG index, const std::string& slice) {
+	auto dims = layout.getDims(index);
+	std::vector<std::string> specs = splitPath(slice, ",");
+	if (dims.empty() || specs.size() > dims.size()) return std::nullopt;
+	TwinCatSlice result{ index, {}, 0, 0, true };
+	ULONG last = 0;
+	bool partial = false;
+	for (size_t dim = 0; dim < dims.size(); dim++) {
+		int64_t lower = dims[dim].lBound;
+		int64_t upper = lower + dims[dim].elements - 1;
+		int64_t first = lower;
+		int64_t end = upper;
+		if (dim < specs.size()) {
+			const std::string& spec = specs[dim];
+			size_t colon = spec.find(':');
+			std::string firstStr = spec.substr(0, colon);
+			std::string endStr = colon == std::string::npos ? firstStr : spec.substr(colon + 1);
+			auto parse = [](const std::string& str, int64_t& value) {
+				return str.empty() || std::from_chars(str.data(), str.data() + str.size(), value).ptr == str.data() + str.size();
+			};
+			if (!parse(firstStr, first) || !parse(endStr, end)) return std::nullopt;
+		}
+		if (first < lower || end > upper || first > end) return std::nullopt;
+		ULONG begin = static_cast<ULONG>(first - lower);
+		ULONG count = static_cast<ULONG>(end - first + 1);
+		// Once a dimension selects several elements, all following dimensions must be selected completely
+		if (partial && count < dims[dim].elements) result.contiguous = false;
+		if (count > 1) partial = true;
+		result.ranges.push_back(std::make_pair(begin, begin + count));
+		result.offset += begin * dims[dim].stride;
+		last += (begin + count - 1) * dims[dim].stride;
+	}
+	result.size = last + layout.nodes[index].size - result.offset;
+	return result;
+}
+
+// Writes selected elements from buffer holding the bytes between first and last selected element
+inline long parseArraySlice(const TwinCatLayout& layout, const TwinCatSlice& slice, std::span<const char> buffer, TwinCatJSONWriter& writer, ULONG offset = 0, ULONG dim = 0) {
+	long nErr{};
+	auto dims = layout.getDims(slice.index);
+	writer.append('[');
+	ULONG first = slice.ranges[dim].first;
+	if ((dim + 1) == dims.size() && writePrimitiveArray(layout.nodes[slice.index], buffer, offset + first * dims[dim].stride - slice.offset, slice.ranges[dim].second - first, writer)) {
+		writer.append(']');
+		return nErr;
+	}
+	for (ULONG i = slice.ranges[dim].first; i < slice.ranges[dim].second; i++) {
+		if (i != slice.ranges[dim].first) {
+			writer.append(',');
+		}
+		ULONG elementOffset = offset + i * dims[dim].stride;
+		long err = (dim + 1) < dims.size()
+			? parseArraySlice(layout, slice, buffer, writer, elementOffset, dim + 1)
+			: writeVariableJSONValue(layout, slice.index, buffer, elementOffset - slice.offset, writer, true);
+		if (err) nErr = err;
+	}
+	writer.append(']');
+	return nErr;
+}
+
+// Decodes selected elements from buffer holding the bytes between first and last selected element
+inline std::pair<long, std::string> getSliceJSONValue(const TwinCatLayout& layout, const TwinCatSlice& slice, std::span<const char> buffer) {
+	TwinCatJSONWriter writer{};
+	long nErr = parseArraySlice(layout, slice, buffer, writer);
+	return std::pair(nErr, std::move(writer.str()));
+}
+
+// Decodes selected elements from buffer holding the raw bytes of the whole symbol/variable
+inline auto getSliceJSONValue(const TwinCatSnapshot& snapshot, const TwinCatVar& variable, const TwinCatSlice& slice, std::span<const char> buffer) {
+	if (slice.offset + slice.size > buffer.size()) return std::make_pair(static_cast<long>(ADSERR_DEVICE_INVALIDSIZE), std::string{});
+	return getSliceJSONValue(snapshot.findLayout(variable), slice, buffer.subspan(slice.offset, slice.size));
+}
+
+// Reads only the bytes between first and last selected element with a single ADS request
+inline auto readSliceBuffer(PAmsAddr pAddr, const TwinCatVar& variable, const TwinCatSlice& slice) {
+	std::vector<char> buffer(slice.size);
+	long nErr = AdsSyncReadReq(pAddr, variable.indexGroup, variable.indexOffset + slice.offset, slice.size, buffer.data());
+	return std::make_pair(nErr, buffer);
+}
+
+// Reads and decodes only the selected elements
+inline auto getSliceJSONValue(PAmsAddr pAddr, const TwinCatSnapshot& snapshot, const TwinCatVar& variable, const TwinCatSlice& slice) {
+	auto [nErr, buffer] = readSliceBuffer(pAddr, variable, slice);
+	if (nErr) return std::make_pair(nErr, std::string{});
+	return getSliceJSONValue(snapshot.findLayout(variable), slice, buffer);
+}
+
+// Decoding applied to the bytes of a read, raw reads skip decoding
+enum class TwinCatDecoding { Json, Document, Raw };
+
+// Raw bytes and decoded value of a single read of symbol/variable, either as JSON text or as JSON document
+struct TwinCatReadResult {
+	long nErr;
+	std::vector<char> buffer;
+	std::string value;
+	nlohmann::json document;
+};
+
+// Deduplicates concurrent reads of symbols/variables keyed by name, snapshot version and kind of decoded value,
+// callers arriving while a read is in flight wait for it and share its bytes and decoded value
+class TwinCatReadGroup {
+public:
+	std::shared_ptr<const TwinCatReadResult> read(PAmsAddr pAddr, const TwinCatSnapshot& snapshot, const TwinCatVar& variable, TwinCatHandleCache* handles = nullptr, TwinCatDecoding decoding = TwinCatDecoding::Json) {
+		auto key = std::make_tuple(snapshot.version, std::string(variable.name), decoding);
+		std::promise<std::shared_ptr<const TwinCatReadResult>> promise{};
+		std::shared_future<std::shared_ptr<const TwinCatReadResult>> inFlight{};
+		{
+			std::lock_guard lock{ mutex };
+			auto it = reads.find(key);
+			if (it != reads.end()) {
+				inFlight = it->second;
+			}
+			else {
+				reads[key] = promise.get_future().share();
+			}
+		}
+		if (inFlight.valid()) return inFlight.get();
+		std::shared_ptr<TwinCatReadResult> result{};
+		try {
+			result = std::make_shared<TwinCatReadResult>();
+			std::tie(result->nErr, result->buffer) = handles ? readVariableBufferByHandle(pAddr, *handles, variable) : readVariableBuffer(pAddr, variable);
+			if (!result->nErr && decoding == TwinCatDecoding::Document) std::tie(result->nErr, result->document) = getVariableJSONDocument(snapshot, variable, result->buffer);
+			else if (!result->nErr && decoding == TwinCatDecoding::Json) std::tie(result->nErr, result->value) = getVariableJSONValue(snapshot, variable, result->buffer);
+		}
+		catch (...) {
+			// Waiting callers get the same exception and later ones start a new read
+			finish(key);
+			promise.set_exception(std::current_exception());
+			throw;
+		}
+		finish(key);
+		promise.set_value(result);
+		return result;
+	}
+
+private:
+	// Callers arriving from now on start a new read, so they never get bytes older than their request
+	void finish(const std::tuple<uint64_t, std::string, TwinCatDecoding>& key) {
+		std::lock_guard lock{ mutex };
+		reads.erase(key);
+	}
+
+	std::mutex mutex;
+	std::map<std::tuple<uint64_t, std::string, TwinCatDecoding>, std::shared_future<std::shared_ptr<const TwinCatReadResult>>> reads;
+};
+
+// Describes flattened layout as JSON text for clients decoding raw bytes themselves:
+// nodes in pre-order with offset relative to parent struct, element size, ADST data type, number of direct members,
+// index of the first node after the node and its members, and array dimensions with lower bound, elements and stride
+inline std::string getLayoutJSON(const TwinCatLayout& layout) {
+	std::stringstream lstream;
+	lstream << "[";
+	for (ULONG index = 0; index < layout.nodes.size(); index++) {
+		const TwinCatLayoutNode& node = layout.nodes[index];
+		if (index > 0) {
+			lstream << ",";
+		}
+		lstream << "{\"Name\":\"" << node.name << "\",";
+		lstream << "\"Offset\":" << node.offset << ",";
+		lstream << "\"Size\":" << node.size << ",";
+		lstream << "\"DataType\":" << node.dataType << ",";
+		lstream << "\"SubItems\":" << node.subItems << ",";
+		lstream << "\"End\":" << node.end << ",";
+		lstream << "\"Dims\":[";
+		bool first = true;
+		for (const TwinCatLayoutDim& dim : layout.getDims(index)) {
+			if (!first) {
+				lstream << ",";
+			}
+			else {
+				first = false;
+			}
+			lstream << "{\"LowerBound\":" << dim.lBound << ",\"Elements\":" << dim.elements << ",\"Stride\":" << dim.stride << "}";
+		}
+		lstream << "]}";
+	}
+	lstream << "]";
+	return lstream.str();
+}
+
+// Layout descriptors as JSON text, built once per datatype and dropped when a new snapshot version is seen
+class TwinCatLayoutCache {
+public:
+	std::shared_ptr<const std::string> get(const TwinCatSnapshot& snapshot, const TwinCatVar& variable) {
+		std::lock_guard lock{ mutex };
+		if (snapshot.version != version) {
+			descriptors.clear();
+			version = snapshot.version;
+		}
+		auto& descriptor = descriptors[std::string(variable.type)];
+		if (!descriptor) {
+			const TwinCatLayout& layout = snapshot.findLayout(variable);
+			std::stringstream dstream;
+			dstream << "{\"Type\":\"" << variable.type << "\",";
+			dstream << "\"Size\":" << (layout.nodes[0].dimCount > 0 ? layout.getDims(0)[0].elements * layout.getDims(0)[0].stride : layout.nodes[0].size) << ",";
+			dstream << "\"Nodes\":" << getLayoutJSON(layout) << "}";
+			descriptor = std::make_shared<const std::string>(dstream.str());
+		}
+		return descriptor;
+	}
+
+private:
+	std::mutex mutex;
+	uint64_t version = 0;
+	std::map<std::string, std::shared_ptr<const std::string>> descriptors;
+};
+
+inline long setVariableJSONValue(const TwinCatLayout& layout, ULONG index, std::span<char> buffer, ULONG offset, const nlohmann::json& jsonValue, bool aryItem = false);
+
+// Adapted from: https://github.com/jisotalo/ads-client/blob/master/src/ads-client.js
+inline std::pair<long, ULONG> unparseArray(const TwinCatLayout& layout, ULONG index, std::span<char> buffer, ULONG offset, const nlohmann::json& jsonValue, ULONG dim) {
+	auto dims = layout.getDims(index);
+	if (!jsonValue.is_array() || jsonValue.size() != dims[dim].elements) {
+		return std::make_pair(static_cast<long>(ADSERR_DEVICE_INVALIDDATA), offset);
+	}
+	long nErr{};
+	for (ULONG i = 0; i < dims[dim].elements; i++) {
+		if ((dim + 1) < dims.size()) {
+			auto [err, noffset] = unparseArray(layout, index, buffer, offset, jsonValue[i], dim + 1);
+			nErr = err;
+			offset = noffset;
+		}
+		else {
+			nErr = setVariableJSONValue(layout, index, buffer, offset, jsonValue[i], true);
+			offset += layout.nodes[index].size;
+		}
+		if (nErr) {
+			break;
+		}
+	}
+	return std::make_pair(nErr, offset);
+}
+
+// Encodes provided json value of layout node into buffer holding the raw bytes of symbol/variable
+inline long setVariableJSONValue(const TwinCatLayout& layout, ULONG index, std::span<char> buffer, ULONG offset, const nlohmann::json& jsonValue, bool aryItem) {
+	long nErr{};
+	const TwinCatLayoutNode& node = layout.nodes[index];
+	if ((node.dimCount == 0 || aryItem) && node.subItems > 0) {
+		if (!jsonValue.is_object()) {
+			return ADSERR_DEVICE_INVALIDDATA;
+		}
+		for (ULONG member = index + 1; member < node.end && !nErr; member = layout.nodes[member].end) {
+			const TwinCatLayoutNode& memberNode = layout.nodes[member];
+			auto value = jsonValue.find(memberNode.name);
+			if (value == jsonValue.end()) {
+				nErr = ADSERR_DEVICE_INVALIDDATA;
+			}
+			else {
+				nErr = setVariableJSONValue(layout, member, buffer, offset + memberNode.offset, *value);
+			}
+		}
+	}
+	else if (node.dimCount > 0 && !aryItem) {
+		nErr = unparseArray(layout, index, buffer, offset, jsonValue, 0).first;
+	}
+	else {
+		ADSDATATYPE type = (ADSDATATYPE)node.dataType;
+		if (type == ADST_VOID && jsonValue.is_null()) {
+		}
+		else if (type == ADST_BIT && jsonValue.is_boolean()) {
+			nErr = writeBufferOffset(buffer, offset, jsonValue.get<bool>());
+		}
+		else if (type == ADST_INT8 && jsonValue.is_number_integer()) {
+			nErr = writeBufferOffset(buffer, offset, jsonValue.get<int8_t>());
+		}
+		else if (type == ADST_INT16 && jsonValue.is_number_integer()) {
+			nErr = writeBufferOffset(buffer, offset, jsonValue.get<int16_t>());
+		}
+		else if (type == ADST_INT32 && jsonValue.is_number_integer()) {
+			nErr = writeBufferOffset(buffer, offset, jsonValue.get<int32_t>());
+		}
+		else if (type == ADST_INT64 && jsonValue.is_number_integer()) {
+			nErr = writeBufferOffset(buffer, offset, jsonValue.get<int64_t>());
+		}
+		else if (type == ADST_UINT8 && jsonValue.is_number_unsigned()) {
+			nErr = writeBufferOffset(buffer, offset, jsonValue.get<uint8_t>());
+		}
+		else if (type == ADST_UINT16 && jsonValue.is_number_unsigned()) {
+			nErr = writeBufferOffset(buffer, offset, jsonValue.get<uint16_t>());
+		}
+		else if (type == ADST_UINT32 && jsonValue.is_number_unsigned()) {
+			nErr = writeBufferOffset(buffer, offset, jsonValue.get<uint32_t>());
+		}
+		else if (type == ADST_UINT64 && jsonValue.is_number_unsigned()) {
+			nErr = writeBufferOffset(buffer, offset, jsonValue.get<uint64_t>());
+		}
+		else if (type == ADST_REAL32 && jsonValue.is_number()) {
+			nErr = writeBufferOffset(buffer, offset, jsonValue.get<float>());
+		}
+		else if (type == ADST_REAL64 && jsonValue.is_number()) {
+			nErr = writeBufferOffset(buffer, offset, jsonValue.get<double>());
+		}
+		else if (type == ADST_STRING && jsonValue.is_string()) {
+			const std::string& valueStr = jsonValue.get_ref<const std::string&>();
+			if (node.size == 0 || offset + node.size > buffer.size()) {
+				nErr = ADSERR_DEVICE_INVALIDSIZE;
+			}
+			else {
+				// Strings are truncated to the declared length and always null terminated
+				size_t length = std::min<size_t>(valueStr.length(), node.size - 1);
+				memcpy(buffer.data() + offset, valueStr.data(), length);
+				memset(buffer.data() + offset + length, 0, node.size - length);
+			}
+		} else {
+			nErr = ADSERR_DEVICE_INVALIDDATA;
+		}
+	}
+	return nErr;
+}
+
+// Encodes provided json value into raw bytes of symbol/variable
+inline auto setVariableJSONValue(const TwinCatSnapshot& snapshot, const TwinCatVar& variable, const nlohmann::json& jsonValue) {
+	std::vector<char> buffer(variable.size);
+	long nErr = setVariableJSONValue(snapshot.findLayout(variable), 0, buffer, 0, jsonValue);
+	return std::make_pair(nErr, buffer);
+}
+
+// Updates symbol/variable based on provided json value with a single ADS request
+inline long setVariableJSONValue(PAmsAddr pAddr, const TwinCatSnapshot& snapshot, const TwinCatVar& variable, const nlohmann::json& jsonValue) {
+	auto [nErr, buffer] = setVariableJSONValue(snapshot, variable, jsonValue);
+	if (nErr) return nErr;
+	return AdsSyncWriteReq(pAddr, variable.indexGroup, variable.indexOffset, variable.size, buffer.data());
+}
+
+// Encodes provided json value into selected elements of buffer holding the bytes between first and last selected element
+inline long unparseArraySlice(const TwinCatLayout& layout, const TwinCatSlice& slice, std::span<char> buffer, const nlohmann::json& jsonValue, ULONG offset = 0, ULONG dim = 0) {
+	auto dims = layout.getDims(slice.index);
+	if (!jsonValue.is_array() || jsonValue.size() != slice.ranges[dim].second - slice.ranges[dim].first) {
+		return ADSERR_DEVICE_INVALIDDATA;
+	}
+	long nErr{};
+	for (ULONG i = slice.ranges[dim].first; i < slice.ranges[dim].second && !nErr; i++) {
+		ULONG elementOffset = offset + i * dims[dim].stride;
+		const nlohmann::json& item = jsonValue[i - slice.ranges[dim].first];
+		nErr = (dim + 1) < dims.size()
+			? unparseArraySlice(layout, slice, buffer, item, elementOffset, dim + 1)
+			: setVariableJSONValue(layout, slice.index, buffer, elementOffset - slice.offset, item, true);
+	}
+	return nErr;
+}
+
+// Updates selected elements based on provided json value with a single ADS request, slice must be contiguous
+inline long setSliceJSONValue(PAmsAddr pAddr, const TwinCatSnapshot& snapshot, const TwinCatVar& variable, const TwinCatSlice& slice, const nlohmann::json& jsonValue) {
+	if (!slice.contiguous) return ADSERR_DEVICE_INVALIDPARM;
+	std::vector<char> buffer(slice.size);
+	long nErr = unparseArraySlice(snapshot.findLayout(variable), slice, buffer, jsonValue);
+	if (nErr) return nErr;
+	return AdsSyncWriteReq(pAddr, variable.indexGroup, variable.indexOffset + slice.offset, slice.size, buffer.data());
+}
+
+// Decodes a body of the form {"Data": value} straight into the raw bytes of symbol/variable while it is parsed, without building a document first.
+// Values are validated against the layout like setVariableJSONValue does, parsing stops at the first invalid value.
+class TwinCatJSONEncoder : public nlohmann::json_sax<nlohmann::json> {
+public:
+	TwinCatJSONEncoder(const TwinCatLayout& layout, std::span<char> buffer) : layout(layout), buffer(buffer) {}
+
+	// Error of first invalid value, a body without Data is invalid as well
+	long error() const { return nErr ? nErr : data ? 0L : static_cast<long>(ADSERR_DEVICE_INVALIDDATA); }
+	// Whether body is no well-formed document
+	bool malformed() const { return invalid; }
+
+	bool null() override {
+		return encode([](ADSDATATYPE type, const TwinCatLayoutNode&, ULONG) { return type == ADST_VOID ? 0L : static_cast<long>(ADSERR_DEVICE_INVALIDDATA); });
+	}
+
+	bool boolean(bool value) override {
+		return encode([&](ADSDATATYPE type, const TwinCatLayoutNode&, ULONG offset) { return type == ADST_BIT ? writeBufferOffset(buffer, offset, value) : static_cast<long>(ADSERR_DEVICE_INVALIDDATA); });
+	}
+
+	bool number_integer(number_integer_t value) override {
+		return encode([&](ADSDATATYPE type, const TwinCatLayoutNode&, ULONG offset) { return writeNumber(type, offset, value); });
+	}
+
+	bool number_unsigned(number_unsigned_t value) override {
+		return encode([&](ADSDATATYPE type, const TwinCatLayoutNode&, ULONG offset) { return writeNumber(type, offset, value); });
+	}
+
+	bool number_float(number_float_t value, const string_t&) override {
+		return encode([&](ADSDATATYPE type, const TwinCatLayoutNode&, ULONG offset) { return writeNumber(type, offset, value); });
+	}
+
+	bool string(string_t& value) override {
+		return encode([&](ADSDATATYPE type, const TwinCatLayoutNode& node, ULONG offset) {
+			if (type != ADST_STRING) return static_cast<long>(ADSERR_DEVICE_INVALIDDATA);
+		if (node.size == 0 || offset + node.size > buffer.size()) return static_cast<long>(ADSERR_DEVICE_INVALIDSIZE);
+		// Strings are truncated to the declared length and always null terminated
+		size_t length = std::min<size_t>(value.length(), node.size - 1);
+		memcpy(buffer.data() + offset, value.data(), length);
+		memset(buffer.data() + offset + length, 0, node.size - length);
+		return 0L;
+			});
+	}
+
+	bool binary(binary_t&) override {
+		return encode([](ADSDATATYPE, const TwinCatLayoutNode&, ULONG) { return static_cast<long>(ADSERR_DEVICE_INVALIDDATA); });
+	}
+
+	bool start_object(std::size_t) override {
+		if (containers.empty() && !started) {
+			started = true;
+			containers.push_back(Container{ Kind::Wrapper });
+			return true;
+		}
+		auto target = take();
+		if (nErr) return false;
+		if (!target) {
+			containers.push_back(Container{ Kind::Skip });
+			return true;
+		}
+		const TwinCatLayoutNode& node = layout.nodes[target->index];
+		if (!((node.dimCount == 0 || target->aryItem) && node.subItems > 0)) return fail(ADSERR_DEVICE_INVALIDDATA);
+		// Members already seen are flagged in a range of the shared vector, so nested structs don't allocate
+		containers.push_back(Container{ Kind::Struct, *target, 0, seen.size() });
+		seen.resize(seen.size() + node.subItems, false);
+		return true;
+	}
+
+	bool key(string_t& value) override {
+		Container& container = containers.back();
+		if (container.kind == Kind::Wrapper) {
+			if (value == "Data") {
+				container.next = Target{ 0, 0, 0, false };
+				data = true;
+			}
+		}
+		else if (container.kind == Kind::Struct) {
+			const TwinCatLayoutNode& node = layout.nodes[container.target.index];
+			size_t ordinal = container.seenBegin;
+			for (ULONG member = container.target.index + 1; member < node.end; member = layout.nodes[member].end, ordinal++) {
+				const TwinCatLayoutNode& memberNode = layout.nodes[member];
+				if (memberNode.name == value) {
+					if (!seen[ordinal]) {
+						seen[ordinal] = true;
+						container.position++;
+					}
+					container.next = Target{ member, container.target.offset + memberNode.offset, 0, false };
+					break;
+				}
+			}
+		}
+		// Keys which are no members are skipped like they are by setVariableJSONValue
+		return true;
+	}
+
+	bool end_object() override {
+		Container container = containers.back();
+		containers.pop_back();
+		if (container.kind != Kind::Struct) return true;
+		seen.resize(container.seenBegin);
+		// Every member must be provided
+		return container.position == layout.nodes[container.target.index].subItems || fail(ADSERR_DEVICE_INVALIDDATA);
+	}
+
+	bool start_array(std::size_t) override {
+		auto target = take();
+		if (nErr) return false;
+		if (!target) {
+			containers.push_back(Container{ Kind::Skip });
+			return true;
+		}
+		const TwinCatLayoutNode& node = layout.nodes[target->index];
+		if (node.dimCount == 0 || target->aryItem) return fail(ADSERR_DEVICE_INVALIDDATA);
+		containers.push_back(Container{ Kind::Array, *target });
+		return true;
+	}
+
+	bool end_array() override {
+		Container container = containers.back();
+		containers.pop_back();
+		if (container.kind != Kind::Array) return true;
+		// Every element must be provided
+		return container.position == layout.getDims(container.target.index)[container.target.dim].elements || fail(ADSERR_DEVICE_INVALIDDATA);
+	}
+
+	bool parse_error(std::size_t, const std::string&, const nlohmann::json::exception&) override {
+		invalid = true;
+		return false;
+	}
+
+private:
+	// Layout node and offset the next value is encoded at, dim is the dimension of arrays that are no items
+	struct Target {
+		ULONG index;
+		ULONG offset;
+		ULONG dim;
+		bool aryItem;
+	};
+
+	enum class Kind { Wrapper, Skip, Struct, Array };
+
+	struct Container {
+		Kind kind;
+		Target target{};
+		// Number of elements or distinct members seen
+		ULONG position = 0;
+		size_t seenBegin = 0;
+		std::optional<Target> next{};
+	};
+
+	// Returns target of the next value within the current container, std::nullopt if the value is skipped
+	std::optional<Target> take() {
+		if (containers.empty()) return std::nullopt;
+		Container& container = containers.back();
+		if (container.kind == Kind::Array) {
+			auto dims = layout.getDims(container.target.index);
+			ULONG dim = container.target.dim;
+			if (container.position >= dims[dim].elements) {
+				fail(ADSERR_DEVICE_INVALIDDATA);
+				return std::nullopt;
+			}
+			ULONG offset = container.target.offset + container.position++ * dims[dim].stride;
+			bool aryItem = (dim + 1) == dims.size();
+			return Target{ container.target.index, offset, aryItem ? 0 : dim + 1, aryItem };
+		}
+		std::optional<Target> next = container.next;
+		container.next.reset();
+		return next;
+	}
+
+	// Encodes primitive value at the next target
+	bool encode(auto&& write) {
+		auto target = take();
+		if (nErr) return false;
+		if (!target) return true;
+		const TwinCatLayoutNode& node = layout.nodes[target->index];
+		if ((node.dimCount > 0 && !target->aryItem) || node.subItems > 0) return fail(ADSERR_DEVICE_INVALIDDATA);
+		return fail(write(static_cast<ADSDATATYPE>(node.dataType), node, target->offset));
+	}
+
+	// Writes number as data type, integers are accepted for integer and real types, but negative ones not for unsigned types
+	long writeNumber(ADSDATATYPE type, ULONG offset, auto value) {
+		using T = decltype(value);
+		switch (type) {
+		case ADST_INT8: if constexpr (std::is_integral_v<T>) return writeBufferOffset(buffer, offset, static_cast<int8_t>(value)); break;
+		case ADST_INT16: if constexpr (std::is_integral_v<T>) return writeBufferOffset(buffer, offset, static_cast<int16_t>(value)); break;
+		case ADST_INT32: if constexpr (std::is_integral_v<T>) return writeBufferOffset(buffer, offset, static_cast<int32_t>(value)); break;
+		case ADST_INT64: if constexpr (std::is_integral_v<T>) return writeBufferOffset(buffer, offset, static_cast<int64_t>(value)); break;
+		case ADST_UINT8: if constexpr (std::is_unsigned_v<T>) return writeBufferOffset(buffer, offset, static_cast<uint8_t>(value)); break;
+		case ADST_UINT16: if constexpr (std::is_unsigned_v<T>) return writeBufferOffset(buffer, offset, static_cast<uint16_t>(value)); break;
+		case ADST_UINT32: if constexpr (std::is_unsigned_v<T>) return writeBufferOffset(buffer, offset, static_cast<uint32_t>(value)); break;
+		case ADST_UINT64: if constexpr (std::is_unsigned_v<T>) return writeBufferOffset(buffer, offset, static_cast<uint64_t>(value)); break;
+		case ADST_REAL32: return writeBufferOffset(buffer, offset, static_cast<float>(value));
+		case ADST_REAL64: return writeBufferOffset(buffer, offset, static_cast<double>(value));
+		default: break;
+		}
+		return ADSERR_DEVICE_INVALIDDATA;
+	}
+
+	bool fail(long err) {
+		nErr = err;
+		return !nErr;
+	}
+
+	const TwinCatLayout& layout;
+	std::span<char> buffer;
+	std::vector<Container> containers;
+	std::vector<bool> seen;
+	long nErr{};
+	bool started = false;
+	bool data = false;
+	bool invalid = false;
+};
+
+// Raw bytes of symbol/variable decoded from a request body
+struct TwinCatWriteResult {
+	long nErr;
+	// False if body is no well-formed document
+	bool valid;
+	std::vector<char> buffer;
+};
+
+// Decodes body of the form {"Data": value} in given format into raw bytes of symbol/variable
+inline TwinCatWriteResult setVariableJSONBody(const TwinCatSnapshot& snapshot, const TwinCatVar& variable, std::string_view body, nlohmann::json::input_format_t format = nlohmann::json::input_format_t::json) {
+	TwinCatWriteResult result{ 0, true, std::vector<char>(variable.size) };
+	TwinCatJSONEncoder encoder{ snapshot.findLayout(variable), result.buffer };
+	nlohmann::json::sax_parse(body, &encoder, format);
+	result.valid = !encoder.malformed();
+	result.nErr = result.valid ? encoder.error() : static_cast<long>(ADSERR_DEVICE_INVALIDDATA);
+	return result;
+}
+
+// Updates symbol/variable from body of the form {"Data": value} with a single ADS request
+inline TwinCatWriteResult setVariableJSONBody(PAmsAddr pAddr, const TwinCatSnapshot& snapshot, const TwinCatVar& variable, std::string_view body, nlohmann::json::input_format_t format = nlohmann::json::input_format_t::json) {
+	TwinCatWriteResult result = setVariableJSONBody(snapshot, variable, body, format);
+	if (!result.nErr) {
+		result.nErr = AdsSyncWriteReq(pAddr, variable.indexGroup, variable.indexOffset, variable.size, result.buffer.data());
+	}
+	return result;
+}
@@ -0,0 +1,601 @@
+// AdsTestServer.h : Loopback AMS/TCP server emulating a TwinCAT PLC for tests.
+// Serves symbol/datatype uploads, plain and sum read/write requests, symbol handles, device state and notifications.
+
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../AmsTcp/AdsDef.h"
+
+class AdsTestServer {
+public:
+	// Index group of PLC memory holding all symbols
+	static constexpr ULONG PLC_MEMORY = 0x4040;
+
+	// Datatype declaration, sub items are members of structs and arrays are given by their dimensions
+	struct Datatype {
+		std::string name;
+		std::string type;
+		ULONG size;
+		ULONG dataType;
+		std::vector<std::pair<ADS_INT32, ULONG>> arrayDims{};
+		std::vector<Datatype> subItems{};
+		ULONG offs = 0;
+		std::string comment{};
+	};
+
+	AdsTestServer() {
+		listenSock = socket(AF_INET, SOCK_STREAM, 0);
+		int reuse = 1;
+		setsockopt(listenSock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		bind(listenSock, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+		socklen_t length = sizeof(address);
+		getsockname(listenSock, reinterpret_cast<sockaddr*>(&address), &length);
+		listenPort = ntohs(address.sin_port);
+		listen(listenSock, 8);
+		memory[PLC_MEMORY] = std::vector<char>(0x10000);
+		acceptor = std::thread([this]() { accept(); });
+		notifier = std::thread([this]() { notify(); });
+	}
+
+	~AdsTestServer() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopped = true;
+		}
+		stopCondition.notify_all();
+		shutdown(listenSock, SHUT_RDWR);
+		close(listenSock);
+		acceptor.join();
+		notifier.join();
+		std::lock_guard<std::mutex> lock(connectionsMutex);
+		for (auto& connection : connections) {
+			shutdown(connection->sock, SHUT_RDWR);
+			connection->thread.join();
+			close(connection->sock);
+		}
+	}
+
+	USHORT port() const {
+		return listenPort;
+	}
+
+	// Adds datatype to datatype upload
+	void addDatatype(const Datatype& datatype) {
+		std::lock_guard<std::mutex> lock(mutex);
+		std::vector<char> entry = getDatatypeEntry(datatype, ADSDATATYPEFLAG_DATATYPE);
+		datatypeUpload.insert(datatypeUpload.end(), entry.begin(), entry.end());
+		datatypes++;
+	}
+
+	// Adds symbol to symbol upload and places it behind the previous symbol in PLC memory, returns its offset
+	ULONG addSymbol(const std::string& name, const std::string& type, ULONG size, ULONG dataType, const std::string& comment = "") {
+		std::lock_guard<std::mutex> lock(mutex);
+		ULONG offset = nextOffset;
+		nextOffset += std::max<ULONG>(size, 1);
+		AdsSymbolEntry entry{ 0, PLC_MEMORY, offset, size, dataType, 0, static_cast<USHORT>(name.length()), static_cast<USHORT>(type.length()), static_cast<USHORT>(comment.length()) };
+		entry.entryLength = static_cast<ULONG>(sizeof(entry) + name.length() + type.length() + comment.length() + 3);
+		const char* data = reinterpret_cast<const char*>(&entry);
+		symbolUpload.insert(symbolUpload.end(), data, data + sizeof(entry));
+		for (const std::string* str : { &name, &type, &comment }) {
+			symbolUpload.insert(symbolUpload.end(), str->c_str(), str->c_str() + str->length() + 1);
+		}
+		symbolOffsets[name] = std::make_pair(offset, size);
+		symbols++;
+		return offset;
+	}
+
+	// Removes all symbols and datatypes, increments symbol version and invalidates all handles like an online change
+	void clearSymbols() {
+		std::lock_guard<std::mutex> lock(mutex);
+		symbolUpload.clear();
+		datatypeUpload.clear();
+		symbolOffsets.clear();
+		handles.clear();
+		symbols = 0;
+		datatypes = 0;
+		nextOffset = 0;
+		symbolVersion++;
+	}
+
+	void setSymbolVersion(UCHAR version) {
+		std::lock_guard<std::mutex> lock(mutex);
+		symbolVersion = version;
+	}
+
+	// Writes raw bytes of symbol
+	void setValue(const std::string& name, const void* data, size_t size) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto [offset, symbolSize] = symbolOffsets.at(name);
+		memcpy(memory[PLC_MEMORY].data() + offset, data, std::min<size_t>(size, symbolSize));
+	}
+
+	template <typename T>
+	void setValue(const std::string& name, const T& value) {
+		setValue(name, &value, sizeof(value));
+	}
+
+	// Returns raw bytes of symbol
+	std::vector<char> getValue(const std::string& name) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto [offset, size] = symbolOffsets.at(name);
+		auto begin = memory[PLC_MEMORY].begin() + offset;
+		return std::vector<char>(begin, begin + size);
+	}
+
+	template <typename T>
+	T getValue(const std::string& name) {
+		T value{};
+		std::vector<char> data = getValue(name);
+		memcpy(&value, data.data(), std::min(sizeof(value), data.size()));
+		return value;
+	}
+
+	// Number of received ADS requests with given command id
+	size_t requestCount(USHORT commandId) {
+		std::lock_guard<std::mutex> lock(mutex);
+		return commandRequests[commandId];
+	}
+
+	// Number of received read, write and read-write requests with given index group, sub commands of sum requests are not counted
+	size_t indexGroupCount(ULONG indexGroup) {
+		std::lock_guard<std::mutex> lock(mutex);
+		return indexGroupRequests[indexGroup];
+	}
+
+	size_t notificationCount() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return notifications.size();
+	}
+
+	// Delays processing of every request, simulating a slow network or PLC
+	void setLatency(std::chrono::milliseconds delay) {
+		latency = delay.count();
+	}
+
+	// Requests are still processed but no longer answered while disabled
+	void setResponding(bool enabled) {
+		std::lock_guard<std::mutex> lock(mutex);
+		responding = enabled;
+	}
+
+	// Sends a frame header announcing almost 4 GB to every connection, like a corrupt stream would
+	void sendOversizedHeader() {
+		std::vector<char> header{};
+		append(header, USHORT{ 0 });
+		append(header, ULONG{ 0xFFFFFFF0 });
+		std::lock_guard<std::mutex> lock(connectionsMutex);
+		for (auto& connection : connections) {
+			std::lock_guard<std::mutex> sendLock(connection->sendMutex);
+			::send(connection->sock, header.data(), header.size(), MSG_NOSIGNAL);
+		}
+	}
+
+	size_t handleCount() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return handles.size();
+	}
+
+	USHORT adsState = ADSSTATE_RUN;
+	USHORT deviceState = 0;
+
+private:
+	struct Connection {
+		int sock;
+		std::mutex sendMutex;
+		std::thread thread;
+	};
+
+#pragma pack(push, 1)
+	struct AmsFrameHeader {
+		USHORT reserved;
+		ULONG tcpLength;
+		AmsNetId targetNetId;
+		USHORT targetPort;
+		AmsNetId sourceNetId;
+		USHORT sourcePort;
+		USHORT commandId;
+		USHORT stateFlags;
+		ULONG length;
+		ULONG errorCode;
+		ULONG invokeId;
+	};
+#pragma pack(pop)
+
+	struct Notification {
+		Connection* connection;
+		AmsFrameHeader request;
+		ULONG indexGroup;
+		ULONG indexOffset;
+		ULONG length;
+		ULONG transMode;
+		std::chrono::nanoseconds cycleTime;
+		std::chrono::steady_clock::time_point due;
+		std::vector<char> last;
+		bool sent;
+	};
+
+	static void append(std::vector<char>& data, const auto& value) {
+		const char* bytes = reinterpret_cast<const char*>(&value);
+		data.insert(data.end(), bytes, bytes + sizeof(value));
+	}
+
+	static ULONG readULong(const std::vector<char>& data, size_t pos) {
+		ULONG value{};
+		if (pos + sizeof(value) <= data.size()) memcpy(&value, data.data() + pos, sizeof(value));
+		return value;
+	}
+
+	static std::vector<char> getDatatypeEntry(const Datatype& datatype, ULONG flags) {
+		std::vector<char> children{};
+		for (const Datatype& subItem : datatype.subItems) {
+			std::vector<char> child = getDatatypeEntry(subItem, ADSDATATYPEFLAG_DATAITEM);
+			children.insert(children.end(), child.begin(), child.end());
+		}
+		AdsDatatypeEntry entry{};
+		entry.version = 1;
+		entry.size = datatype.size;
+		entry.offs = datatype.offs;
+		entry.dataType = datatype.dataType;
+		entry.flags = flags;
+		entry.nameLength = static_cast<ADS_UINT16>(datatype.name.length());
+		entry.typeLength = static_cast<ADS_UINT16>(datatype.type.length());
+		entry.commentLength = static_cast<ADS_UINT16>(datatype.comment.length());
+		entry.arrayDim = static_cast<ADS_UINT16>(datatype.arrayDims.size());
+		entry.subItems = static_cast<ADS_UINT16>(datatype.subItems.size());
+		entry.entryLength = static_cast<ADS_UINT32>(sizeof(entry) + entry.nameLength + entry.typeLength + entry.commentLength + 3
+			+ entry.arrayDim * sizeof(AdsDatatypeArrayInfo) + children.size());
+		std::vector<char> data{};
+		append(data, entry);
+		for (const std::string* str : { &datatype.name, &datatype.type, &datatype.comment }) {
+			data.insert(data.end(), str->c_str(), str->c_str() + str->length() + 1);
+		}
+		for (const auto& [lBound, elements] : datatype.arrayDims) {
+			append(data, AdsDatatypeArrayInfo{ lBound, elements });
+		}
+		data.insert(data.end(), children.begin(), children.end());
+		return data;
+	}
+
+	void accept() {
+		for (;;) {
+			int sock = ::accept(listenSock, nullptr, nullptr);
+			if (sock < 0) return;
+			int noDelay = 1;
+			setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+			std::lock_guard<std::mutex> lock(connectionsMutex);
+			auto connection = std::make_unique<Connection>();
+			connection->sock = sock;
+			Connection* pConnection = connection.get();
+			connection->thread = std::thread([this, pConnection]() { serve(*pConnection); });
+			connections.push_back(std::move(connection));
+		}
+	}
+
+	static bool receiveAll(int sock, void* data, size_t size) {
+		for (size_t received = 0; received < size;) {
+			ssize_t n = recv(sock, static_cast<char*>(data) + received, size - received, 0);
+			if (n <= 0) return false;
+			received += static_cast<size_t>(n);
+		}
+		return true;
+	}
+
+	static void send(Connection& connection, const AmsFrameHeader& request, USHORT commandId, USHORT stateFlags, ULONG invokeId, const std::vector<char>& payload) {
+		AmsFrameHeader header{ 0, static_cast<ULONG>(sizeof(AmsFrameHeader) - 6 + payload.size()), request.sourceNetId, request.sourcePort, request.targetNetId, request.targetPort,
+			commandId, stateFlags, static_cast<ULONG>(payload.size()), 0, invokeId };
+		std::vector<char> frame{};
+		append(frame, header);
+		frame.insert(frame.end(), payload.begin(), payload.end());
+		std::lock_guard<std::mutex> lock(connection.sendMutex);
+		for (size_t sent = 0; sent < frame.size();) {
+			ssize_t n = ::send(connection.sock, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+			if (n <= 0) return;
+			sent += static_cast<size_t>(n);
+		}
+	}
+
+	void serve(Connection& connection) {
+		for (;;) {
+			AmsFrameHeader header{};
+			if (!receiveAll(connection.sock, &header, sizeof(header))) break;
+			std::vector<char> data(header.tcpLength - (sizeof(header) - 6));
+			if (!receiveAll(connection.sock, data.data(), data.size())) break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(latency));
+			// Response is sent under the lock so that no notification of a new handle overtakes it
+			std::lock_guard<std::mutex> lock(mutex);
+			std::vector<char> response = handle(connection, header, data);
+			if (responding) send(connection, header, header.commandId, 0x0005, header.invokeId, response);
+		}
+		// Notifications of a closed connection are deleted like a router does when the client port is gone
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto it = notifications.begin(); it != notifications.end();) {
+			it = it->second.connection == &connection ? notifications.erase(it) : std::next(it);
+		}
+	}
+
+	// Returns ADS response data (result code followed by command specific data), requires lock
+	std::vector<char> handle(Connection& connection, const AmsFrameHeader& header, const std::vector<char>& data) {
+		commandRequests[header.commandId]++;
+		std::vector<char> response{};
+		switch (header.commandId) {
+		case 0x1: {
+			append(response, ULONG{ 0 });
+			append(response, AdsVersion{ 3, 1, 4024 });
+			char name[16]{ "AdsTestServer" };
+			response.insert(response.end(), name, name + sizeof(name));
+			break;
+		}
+		case 0x2: {
+			ULONG indexGroup = readULong(data, 0);
+			indexGroupRequests[indexGroup]++;
+			std::vector<char> value{};
+			ULONG nErr = read(indexGroup, readULong(data, 4), readULong(data, 8), value);
+			append(response, nErr);
+			append(response, static_cast<ULONG>(value.size()));
+			response.insert(response.end(), value.begin(), value.end());
+			break;
+		}
+		case 0x3: {
+			ULONG indexGroup = readULong(data, 0);
+			indexGroupRequests[indexGroup]++;
+			ULONG length = readULong(data, 8);
+			std::vector<char> value(data.begin() + 12, data.begin() + 12 + std::min<size_t>(length, data.size() - 12));
+			append(response, write(indexGroup, readULong(data, 4), value));
+			break;
+		}
+		case 0x4:
+			append(response, ULONG{ 0 });
+			append(response, adsState);
+			append(response, deviceState);
+			break;
+		case 0x5: {
+			USHORT state{};
+			memcpy(&state, data.data(), sizeof(state));
+			adsState = state;
+			append(response, ULONG{ 0 });
+			break;
+		}
+		case 0x6: {
+			ULONG indexGroup = readULong(data, 0);
+			ULONG indexOffset = readULong(data, 4);
+			ULONG length = readULong(data, 8);
+			ULONG transMode = readULong(data, 12);
+			ULONG cycleTime = readULong(data, 20);
+			std::vector<char> value{};
+			ULONG nErr = read(indexGroup, indexOffset, length, value);
+			append(response, nErr);
+			if (nErr) break;
+			ULONG hNotification = nextNotification++;
+			notifications[hNotification] = Notification{ &connection, header, indexGroup, indexOffset, length, transMode,
+				std::chrono::nanoseconds(static_cast<int64_t>(cycleTime) * 100), std::chrono::steady_clock::now(), {}, false };
+			append(response, hNotification);
+			stopCondition.notify_all();
+			break;
+		}
+		case 0x7:
+			append(response, static_cast<ULONG>(notifications.erase(readULong(data, 0)) ? ADSERR_NOERR : ADSERR_DEVICE_NOTIFYHNDINVALID));
+			break;
+		case 0x9: {
+			ULONG indexGroup = readULong(data, 0);
+			indexGroupRequests[indexGroup]++;
+			ULONG readLength = readULong(data, 8);
+			ULONG writeLength = readULong(data, 12);
+			std::vector<char> value(data.begin() + 16, data.begin() + 16 + std::min<size_t>(writeLength, data.size() - 16));
+			std::vector<char> result{};
+			ULONG nErr = readWrite(indexGroup, readULong(data, 4), readLength, value, result);
+			if (result.size() > readLength) result.resize(readLength);
+			append(response, nErr);
+			append(response, static_cast<ULONG>(nErr ? 0 : result.size()));
+			if (!nErr) response.insert(response.end(), result.begin(), result.end());
+			break;
+		}
+		default:
+			append(response, ULONG{ ADSERR_DEVICE_SRVNOTSUPP });
+		}
+		return response;
+	}
+
+	// Resolves symbol handle to memory area
+	ULONG resolveHandle(ULONG hSymbol, ULONG& offset, ULONG& size) {
+		auto it = handles.find(hSymbol);
+		if (it == handles.end()) return ADSERR_DEVICE_SYMBOLNOTFOUND;
+		auto symbol = symbolOffsets.find(it->second);
+		if (symbol == symbolOffsets.end()) return ADSERR_DEVICE_SYMBOLNOTFOUND;
+		offset = symbol->second.first;
+		size = symbol->second.second;
+		return ADSERR_NOERR;
+	}
+
+	ULONG read(ULONG indexGroup, ULONG indexOffset, ULONG length, std::vector<char>& value) {
+		switch (indexGroup) {
+		case ADSIGRP_SYM_VERSION:
+			value.assign(1, static_cast<char>(symbolVersion));
+			return ADSERR_NOERR;
+		case ADSIGRP_SYM_UPLOADINFO2: {
+			AdsSymbolUploadInfo2 info{ symbols, static_cast<ULONG>(symbolUpload.size()), datatypes, static_cast<ULONG>(datatypeUpload.size()), 0, 0 };
+			value.assign(reinterpret_cast<const char*>(&info), reinterpret_cast<const char*>(&info) + sizeof(info));
+			break;
+		}
+		case ADSIGRP_SYM_UPLOAD:
+			value = symbolUpload;
+			break;
+		case ADSIGRP_SYM_DT_UPLOAD:
+			value = datatypeUpload;
+			break;
+		case ADSIGRP_SYM_VALBYHND: {
+			ULONG offset{};
+			ULONG size{};
+			if (ULONG nErr = resolveHandle(indexOffset, offset, size)) return nErr;
+			if (length > size) return ADSERR_DEVICE_INVALIDSIZE;
+			return read(PLC_MEMORY, offset, length, value);
+		}
+		default: {
+			auto it = memory.find(indexGroup);
+			if (it == memory.end()) return ADSERR_DEVICE_INVALIDGRP;
+			if (static_cast<size_t>(indexOffset) + length > it->second.size()) return ADSERR_DEVICE_INVALIDSIZE;
+			value.assign(it->second.begin() + indexOffset, it->second.begin() + indexOffset + length);
+			return ADSERR_NOERR;
+		}
+		}
+		if (value.size() > length) value.resize(length);
+		return ADSERR_NOERR;
+	}
+
+	ULONG write(ULONG indexGroup, ULONG indexOffset, const std::vector<char>& value) {
+		switch (indexGroup) {
+		case ADSIGRP_SYM_RELEASEHND:
+			return handles.erase(readULong(value, 0)) ? ADSERR_NOERR : ADSERR_DEVICE_NOTFOUND;
+		case ADSIGRP_SYM_VALBYHND: {
+			ULONG offset{};
+			ULONG size{};
+			if (ULONG nErr = resolveHandle(indexOffset, offset, size)) return nErr;
+			if (value.size() > size) return ADSERR_DEVICE_INVALIDSIZE;
+			return write(PLC_MEMORY, offset, value);
+		}
+		default: {
+			auto it = memory.find(indexGroup);
+			if (it == memory.end()) return ADSERR_DEVICE_INVALIDGRP;
+			if (indexOffset + value.size() > it->second.size()) return ADSERR_DEVICE_INVALIDSIZE;
+			std::copy(value.begin(), value.end(), it->second.begin() + indexOffset);
+			return ADSERR_NOERR;
+		}
+		}
+	}
+
+	ULONG readWrite(ULONG indexGroup, ULONG indexOffset, ULONG readLength, const std::vector<char>& value, std::vector<char>& result) {
+		switch (indexGroup) {
+		case ADSIGRP_SYM_HNDBYNAME: {
+			std::string name(value.begin(), std::find(value.begin(), value.end(), '\0'));
+			if (!symbolOffsets.contains(name)) return ADSERR_DEVICE_SYMBOLNOTFOUND;
+			ULONG hSymbol = nextHandle++;
+			handles[hSymbol] = name;
+			append(result, hSymbol);
+			return ADSERR_NOERR;
+		}
+		case ADSIGRP_SUMUP_READ: {
+			// Error codes of all sub commands followed by the data of all sub commands with their requested length
+			std::vector<char> values{};
+			for (ULONG i = 0; i < indexOffset; i++) {
+				ULONG length = readULong(value, i * 12 + 8);
+				std::vector<char> item{};
+				ULONG nErr = read(readULong(value, i * 12), readULong(value, i * 12 + 4), length, item);
+				item.resize(length);
+				append(result, nErr);
+				values.insert(values.end(), item.begin(), item.end());
+			}
+			result.insert(result.end(), values.begin(), values.end());
+			return ADSERR_NOERR;
+		}
+		case ADSIGRP_SUMUP_WRITE: {
+			size_t pos = indexOffset * 12;
+			for (ULONG i = 0; i < indexOffset; i++) {
+				ULONG length = readULong(value, i * 12 + 8);
+				std::vector<char> item(value.begin() + pos, value.begin() + std::min(pos + length, value.size()));
+				pos += length;
+				append(result, write(readULong(value, i * 12), readULong(value, i * 12 + 4), item));
+			}
+			return ADSERR_NOERR;
+		}
+		case ADSIGRP_SUMUP_READWRITE: {
+			// Error code and returned length of all sub commands followed by the returned data
+			size_t pos = indexOffset * 16;
+			std::vector<char> values{};
+			for (ULONG i = 0; i < indexOffset; i++) {
+				ULONG itemReadLength = readULong(value, i * 16 + 8);
+				ULONG itemWriteLength = readULong(value, i * 16 + 12);
+				std::vector<char> item(value.begin() + pos, value.begin() + std::min(pos + itemWriteLength, value.size()));
+				pos += itemWriteLength;
+				std::vector<char> itemResult{};
+				ULONG nErr = readWrite(readULong(value, i * 16), readULong(value, i * 16 + 4), itemReadLength, item, itemResult);
+				if (itemResult.size() > itemReadLength) itemResult.resize(itemReadLength);
+				append(result, nErr);
+				append(result, static_cast<ULONG>(itemResult.size()));
+				values.insert(values.end(), itemResult.begin(), itemResult.end());
+			}
+			result.insert(result.end(), values.begin(), values.end());
+			return ADSERR_NOERR;
+		}
+		default: {
+			ULONG nErr = write(indexGroup, indexOffset, value);
+			if (nErr || !readLength) return nErr;
+			return read(indexGroup, indexOffset, readLength, result);
+		}
+		}
+	}
+
+	// Sends device notifications, on change notifications are checked every millisecond
+	void notify() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!stopped) {
+			auto now = std::chrono::steady_clock::now();
+			for (auto& [hNotification, notification] : notifications) {
+				std::vector<char> value{};
+				if (read(notification.indexGroup, notification.indexOffset, notification.length, value)) continue;
+				bool cyclic = notification.transMode == ADSTRANS_SERVERCYCLE;
+				if (cyclic ? now < notification.due : (notification.sent && value == notification.last)) continue;
+				notification.due = now + notification.cycleTime;
+				notification.last = value;
+				notification.sent = true;
+				// Notification stream with a single stamp holding a single sample
+				std::vector<char> payload{};
+				append(payload, static_cast<ULONG>(2 * sizeof(ULONG) + sizeof(int64_t) + 3 * sizeof(ULONG) + value.size()));
+				append(payload, ULONG{ 1 });
+				append(payload, static_cast<int64_t>(116444736000000000LL + std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 100));
+				append(payload, ULONG{ 1 });
+				append(payload, hNotification);
+				append(payload, static_cast<ULONG>(value.size()));
+				payload.insert(payload.end(), value.begin(), value.end());
+				send(*notification.connection, notification.request, 0x8, 0x0004, 0, payload);
+			}
+			stopCondition.wait_for(lock, std::chrono::milliseconds(1));
+		}
+	}
+
+	int listenSock = -1;
+	USHORT listenPort = 0;
+	std::thread acceptor{};
+	std::thread notifier{};
+	std::mutex connectionsMutex;
+	std::list<std::unique_ptr<Connection>> connections{};
+	std::mutex mutex;
+	std::condition_variable stopCondition;
+	bool stopped = false;
+	bool responding = true;
+	std::atomic<int64_t> latency = 0;
+	std::map<ULONG, std::vector<char>> memory{};
+	std::vector<char> symbolUpload{};
+	std::vector<char> datatypeUpload{};
+	std::map<std::string, std::pair<ULONG, ULONG>> symbolOffsets{};
+	std::map<ULONG, std::string> handles{};
+	std::map<ULONG, Notification> notifications{};
+	std::map<USHORT, size_t> commandRequests{};
+	std::map<ULONG, size_t> indexGroupRequests{};
+	ULONG symbols = 0;
+	ULONG datatypes = 0;
+	ULONG nextOffset = 0;
+	ULONG nextHandle = 1;
+	ULONG nextNotification = 1;
+	UCHAR symbolVersion = 1;
+};
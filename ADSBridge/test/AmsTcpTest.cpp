@@ -0,0 +1,171 @@
+// AmsTcpTest.cpp : Tests of the native AMS/TCP backend against the emulated PLC.
+//
+#include "Test.h"
+#include "TestPlc.h"
+
+TEST_CASE(readsDeviceInfoAndState) {
+	TestPlc plc{};
+	char devName[50]{};
+	AdsVersion version{};
+	CHECK_EQUAL(AdsSyncReadDeviceInfoReq(plc.pAddr, devName, &version), 0);
+	CHECK_EQUAL(std::string(devName), "AdsTestServer");
+	CHECK_EQUAL(version.build, 4024);
+	USHORT adsState{};
+	USHORT deviceState{};
+	CHECK_EQUAL(AdsSyncReadStateReq(plc.pAddr, &adsState, &deviceState), 0);
+	CHECK_EQUAL(adsState, ADSSTATE_RUN);
+	CHECK_EQUAL(AdsSyncWriteControlReq(plc.pAddr, ADSSTATE_STOP, 0, 0, nullptr), 0);
+	CHECK_EQUAL(AdsSyncReadStateReq(plc.pAddr, nullptr, &deviceState), 0);
+	CHECK_EQUAL(AdsSyncReadStateReq(plc.pAddr, &adsState, nullptr), 0);
+	CHECK_EQUAL(adsState, ADSSTATE_STOP);
+}
+
+TEST_CASE(readsAndWritesByIndexGroup) {
+	TestPlc plc{};
+	plc.server.setValue("MAIN.nCounter", ADS_INT32{ 42 });
+	ADS_INT32 value{};
+	ULONG read{};
+	CHECK_EQUAL(AdsSyncReadReqEx(plc.pAddr, AdsTestServer::PLC_MEMORY, 0, sizeof(value), &value, &read), 0);
+	CHECK_EQUAL(value, 42);
+	CHECK_EQUAL(read, sizeof(value));
+	value = -7;
+	CHECK_EQUAL(AdsSyncWriteReq(plc.pAddr, AdsTestServer::PLC_MEMORY, 0, sizeof(value), &value), 0);
+	CHECK_EQUAL(plc.server.getValue<ADS_INT32>("MAIN.nCounter"), -7);
+	CHECK_EQUAL(AdsSyncReadReq(plc.pAddr, 0x1234, 0, sizeof(value), &value), ADSERR_DEVICE_INVALIDGRP);
+	CHECK_EQUAL(AdsSyncReadReq(plc.pAddr, AdsTestServer::PLC_MEMORY, 0xFFFF, sizeof(value), &value), ADSERR_DEVICE_INVALIDSIZE);
+}
+
+TEST_CASE(pipelinesConcurrentRequests) {
+	TestPlc plc{};
+	plc.server.setValue("MAIN.nCounter", ADS_INT32{ 5 });
+	std::vector<std::thread> threads{};
+	std::atomic<int> failures = 0;
+	for (int t = 0; t < 8; t++) {
+		threads.emplace_back([&plc, &failures]() {
+			for (int i = 0; i < 50; i++) {
+				ADS_INT32 value{};
+				if (AdsSyncReadReq(plc.pAddr, AdsTestServer::PLC_MEMORY, 0, sizeof(value), &value) || value != 5) failures++;
+			}
+		});
+	}
+	for (std::thread& thread : threads) thread.join();
+	CHECK_EQUAL(failures.load(), 0);
+	CHECK_EQUAL(plc.server.requestCount(0x2), 400u);
+}
+
+TEST_CASE(deliversDeviceNotifications) {
+	TestPlc plc{};
+	static std::atomic<ADS_INT32> received{};
+	static std::atomic<ULONG> user{};
+	AdsNotificationAttrib attrib{ sizeof(ADS_INT32), ADSTRANS_SERVERONCHA, 0, { 0 } };
+	auto callback = [](AmsAddr*, AdsNotificationHeader* pNotification, ULONG hUser) {
+		ADS_INT32 value{};
+		memcpy(&value, pNotification->data, sizeof(value));
+		received = value;
+		user = hUser;
+	};
+	plc.server.setValue("MAIN.nCounter", ADS_INT32{ 1 });
+	ULONG hNotification{};
+	CHECK_EQUAL(AdsSyncAddDeviceNotificationReq(plc.pAddr, AdsTestServer::PLC_MEMORY, 0, &attrib, callback, 77, &hNotification), 0);
+	CHECK(waitFor([]() { return received == 1; }));
+	CHECK_EQUAL(user.load(), 77u);
+	plc.server.setValue("MAIN.nCounter", ADS_INT32{ 2 });
+	CHECK(waitFor([]() { return received == 2; }));
+	CHECK_EQUAL(AdsSyncDelDeviceNotificationReq(plc.pAddr, hNotification), 0);
+	CHECK_EQUAL(plc.server.notificationCount(), 0u);
+	CHECK_EQUAL(AdsSyncDelDeviceNotificationReq(plc.pAddr, hNotification), ADSERR_DEVICE_NOTIFYHNDINVALID);
+}
+
+TEST_CASE(failsWithoutRouter) {
+	USHORT port{};
+	{
+		AdsTestServer server{};
+		port = server.port();
+	}
+	AmsTcpSetRouter("127.0.0.1", port);
+	AdsPortOpen();
+	AmsAddr addr{};
+	CHECK_EQUAL(AdsGetLocalAddress(&addr), 0);
+	CHECK_EQUAL(addr.netId.b[0], 127);
+	addr.port = 851;
+	ADS_INT32 value{};
+	CHECK_EQUAL(AdsSyncReadReq(&addr, AdsTestServer::PLC_MEMORY, 0, sizeof(value), &value), ADSERR_CLIENT_W32ERROR);
+	AdsPortClose();
+	CHECK_EQUAL(AdsSyncReadReq(&addr, AdsTestServer::PLC_MEMORY, 0, sizeof(value), &value), ADSERR_CLIENT_PORTNOTOPEN);
+}
+
+TEST_CASE(completesAsyncRequests) {
+	TestPlc plc{};
+	plc.server.setValue("MAIN.fValue", 0.25);
+	double value = 0.5;
+	auto write = AdsAsyncWriteReq(plc.pAddr, AdsTestServer::PLC_MEMORY, 4, sizeof(value), &value);
+	value = 0;
+	std::vector<std::future<AdsAsyncResult>> reads{};
+	for (int i = 0; i < 100; i++) {
+		reads.push_back(AdsAsyncReadReq(plc.pAddr, AdsTestServer::PLC_MEMORY, 4, sizeof(value)));
+	}
+	CHECK_EQUAL(write.get().nErr, 0);
+	for (auto& read : reads) {
+		AdsAsyncResult result = read.get();
+		CHECK_EQUAL(result.nErr, 0);
+		CHECK_EQUAL(result.data.size(), sizeof(value));
+		memcpy(&value, result.data.data(), sizeof(value));
+		CHECK_EQUAL(value, 0.5);
+	}
+	std::string name{ "MAIN.nCounter" };
+	AdsAsyncResult handle = AdsAsyncReadWriteReq(plc.pAddr, ADSIGRP_SYM_HNDBYNAME, 0, sizeof(ULONG), static_cast<ULONG>(name.size()), name.data()).get();
+	CHECK_EQUAL(handle.nErr, 0);
+	CHECK_EQUAL(handle.data.size(), sizeof(ULONG));
+}
+
+TEST_CASE(timesOutUnansweredRequests) {
+	TestPlc plc{};
+	AdsSyncSetTimeout(100);
+	plc.server.setResponding(false);
+	auto start = std::chrono::steady_clock::now();
+	auto read = AdsAsyncReadReq(plc.pAddr, AdsTestServer::PLC_MEMORY, 0, 4);
+	CHECK(read.wait_for(std::chrono::seconds(2)) == std::future_status::ready);
+	CHECK_EQUAL(read.get().nErr, ADSERR_CLIENT_SYNCTIMEOUT);
+	CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(100));
+	plc.server.setResponding(true);
+	ADS_INT32 value{};
+	CHECK_EQUAL(AdsSyncReadReq(plc.pAddr, AdsTestServer::PLC_MEMORY, 0, sizeof(value), &value), 0);
+	AdsSyncSetTimeout(5000);
+}
+
+TEST_CASE(timesOutRequestsWhileNotificationsArrive) {
+	TestPlc plc{};
+	static std::atomic<int> samples{};
+	// Cyclic samples every millisecond keep the receive thread from ever running into its receive timeout
+	AdsNotificationAttrib attrib{ sizeof(ADS_INT32), ADSTRANS_SERVERCYCLE, 0, { 10000 } };
+	auto callback = [](AmsAddr*, AdsNotificationHeader*, ULONG) { samples++; };
+	ULONG hNotification{};
+	CHECK_EQUAL(AdsSyncAddDeviceNotificationReq(plc.pAddr, AdsTestServer::PLC_MEMORY, 0, &attrib, callback, 0, &hNotification), 0);
+	CHECK(waitFor([]() { return samples > 0; }));
+	AdsSyncSetTimeout(100);
+	plc.server.setResponding(false);
+	int before = samples;
+	auto read = AdsAsyncReadReq(plc.pAddr, AdsTestServer::PLC_MEMORY, 0, 4);
+	bool ready = read.wait_for(std::chrono::seconds(2)) == std::future_status::ready;
+	CHECK(ready);
+	CHECK(ready && read.get().nErr == ADSERR_CLIENT_SYNCTIMEOUT);
+	CHECK(samples > before + 10);
+	plc.server.setResponding(true);
+	CHECK_EQUAL(AdsSyncDelDeviceNotificationReq(plc.pAddr, hNotification), 0);
+	AdsSyncSetTimeout(5000);
+}
+
+TEST_CASE(dropsConnectionOnOversizedFrame) {
+	TestPlc plc{};
+	ADS_INT32 value{};
+	CHECK_EQUAL(AdsSyncReadReq(plc.pAddr, AdsTestServer::PLC_MEMORY, 0, sizeof(value), &value), 0);
+	plc.server.setResponding(false);
+	auto read = AdsAsyncReadReq(plc.pAddr, AdsTestServer::PLC_MEMORY, 0, 4);
+	// The pending request fails like on a lost connection instead of the frame being allocated
+	plc.server.sendOversizedHeader();
+	bool ready = read.wait_for(std::chrono::seconds(2)) == std::future_status::ready;
+	CHECK(ready);
+	CHECK(ready && read.get().nErr == ADSERR_CLIENT_W32ERROR);
+	plc.server.setResponding(true);
+	CHECK_EQUAL(AdsSyncReadReq(plc.pAddr, AdsTestServer::PLC_MEMORY, 0, sizeof(value), &value), 0);
+}
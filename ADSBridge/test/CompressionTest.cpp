@@ -0,0 +1,75 @@
+// CompressionTest.cpp : Tests of content coding negotiation and response compression.
+//
+#include "Test.h"
+#include "../Compression.h"
+#ifdef ADSBRIDGE_BROTLI_SUPPORT
+#include <brotli/decode.h>
+#endif
+
+TEST_CASE(negotiatesContentEncodings) {
+	CHECK(getContentEncoding("") == ContentEncoding::Identity);
+	CHECK(getContentEncoding("deflate, identity") == ContentEncoding::Identity);
+#ifdef ADSBRIDGE_ZLIB_SUPPORT
+	CHECK(getContentEncoding("GZIP") == ContentEncoding::Gzip);
+	CHECK(getContentEncoding("br;q=0, gzip;q=0.5") == ContentEncoding::Gzip);
+#endif
+#ifdef ADSBRIDGE_BROTLI_SUPPORT
+	CHECK(getContentEncoding("gzip, deflate, br") == ContentEncoding::Brotli);
+	CHECK(getContentEncoding("*") == ContentEncoding::Brotli);
+	CHECK(getContentEncoding("gzip;q=0.5, br;q=0.5") == ContentEncoding::Brotli);
+	CHECK(getContentEncoding("gzip;q=0.5, *;q=0.8") == ContentEncoding::Brotli);
+#endif
+#if defined(ADSBRIDGE_ZLIB_SUPPORT) && defined(ADSBRIDGE_BROTLI_SUPPORT)
+	// Higher quality wins over Brotli being preferred
+	CHECK(getContentEncoding("gzip;q=1, br;q=0.1") == ContentEncoding::Gzip);
+	CHECK(getContentEncoding("br;q=0.2, *;q=0.9") == ContentEncoding::Gzip);
+#endif
+	CHECK(getContentEncoding("gzip;q=0, br;q=0.0") == ContentEncoding::Identity);
+}
+
+TEST_CASE(compressesStreamedBodies) {
+	std::string body{};
+	for (int i = 0; i < 20000; i++) {
+		body += "{\"Name\":\"MAIN.aValues[" + std::to_string(i) + "]\",\"Size\":2},";
+	}
+	auto identity = compressBody(body, ContentEncoding::Identity);
+	CHECK(identity && *identity == body);
+#ifdef ADSBRIDGE_ZLIB_SUPPORT
+	// Chunks written one after another form a single gzip member
+	std::string gzip{};
+	StreamCompressor compressor{ ContentEncoding::Gzip, [&gzip](const char* data, size_t size) {
+		gzip.append(data, size);
+		return true;
+	} };
+	for (size_t offset = 0; offset < body.size(); offset += 10000) {
+		CHECK(compressor.write(body.data() + offset, std::min<size_t>(10000, body.size() - offset)));
+	}
+	CHECK(compressor.write(nullptr, 0, true));
+	CHECK(gzip.size() < body.size() / 10);
+	CHECK_EQUAL(gzip.substr(0, 2), std::string("\x1f\x8b"));
+	z_stream zstream{};
+	CHECK_EQUAL(inflateInit2(&zstream, 15 + 16), Z_OK);
+	std::string inflated(body.size() + 1, '\0');
+	zstream.next_in = reinterpret_cast<Bytef*>(gzip.data());
+	zstream.avail_in = static_cast<uInt>(gzip.size());
+	zstream.next_out = reinterpret_cast<Bytef*>(inflated.data());
+	zstream.avail_out = static_cast<uInt>(inflated.size());
+	CHECK_EQUAL(inflate(&zstream, Z_FINISH), Z_STREAM_END);
+	inflated.resize(zstream.total_out);
+	inflateEnd(&zstream);
+	CHECK(inflated == body);
+#endif
+#ifdef ADSBRIDGE_BROTLI_SUPPORT
+	auto brotli = compressBody(body, ContentEncoding::Brotli);
+	CHECK(brotli && brotli->size() < body.size() / 10);
+	std::string decoded(body.size() + 1, '\0');
+	size_t decodedSize = decoded.size();
+	CHECK_EQUAL(BrotliDecoderDecompress(brotli->size(), reinterpret_cast<const uint8_t*>(brotli->data()), &decodedSize, reinterpret_cast<uint8_t*>(decoded.data())), BROTLI_DECODER_RESULT_SUCCESS);
+	decoded.resize(decodedSize);
+	CHECK(decoded == body);
+#endif
+	// A failing sink stops compression
+	StreamCompressor failing{ ContentEncoding::Identity, [](const char*, size_t) { return false; } };
+	CHECK(!failing.write(body.data(), body.size()));
+	CHECK(!failing.write(nullptr, 0, true));
+}
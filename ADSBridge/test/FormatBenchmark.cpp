@@ -0,0 +1,84 @@
+// FormatBenchmark.cpp : Compares formatting of large primitive arrays as JSON text:
+// one stringstream per element as readGroupOffset/readBufferOffset did before, one writer call per element,
+// and the batched fast path of parseArray.
+//
+#include <chrono>
+#include <iostream>
+#include <random>
+#include "../TwinCat.h"
+
+// Formats array like the former operator<< path, a stream per element and one for the array
+template <typename T>
+std::string formatWithStreams(std::span<const char> buffer, ULONG count) {
+	std::stringstream rstream;
+	rstream << "[";
+	for (ULONG i = 0; i < count; i++) {
+		if (i > 0) {
+			rstream << ",";
+		}
+		T data{};
+		memcpy(&data, buffer.data() + i * sizeof(T), sizeof(T));
+		std::stringstream dstream;
+		dstream << +data;
+		rstream << dstream.str();
+	}
+	rstream << "]";
+	return rstream.str();
+}
+
+// Formats array element by element through the writer, as the decoder does for arrays of structs
+std::string formatPerElement(const TwinCatLayout& layout, std::span<const char> buffer, ULONG count) {
+	TwinCatJSONWriter writer{};
+	writer.append('[');
+	for (ULONG i = 0; i < count; i++) {
+		if (i > 0) {
+			writer.append(',');
+		}
+		writeVariableJSONValue(layout, 0, buffer, i * layout.nodes[0].size, writer, true);
+	}
+	writer.append(']');
+	return std::move(writer.str());
+}
+
+// Returns average milliseconds of a call to format
+double measure(const std::function<std::string()>& format, size_t& bytes) {
+	constexpr int RUNS = 10;
+	auto start = std::chrono::steady_clock::now();
+	for (int run = 0; run < RUNS; run++) {
+		bytes = format().size();
+	}
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / RUNS;
+}
+
+template <typename T>
+void benchmark(const std::string& name, ADSDATATYPE dataType, ULONG count) {
+	std::mt19937 random{ 42 };
+	std::vector<T> values(count);
+	for (T& value : values) {
+		if constexpr (std::is_floating_point_v<T>) {
+			value = static_cast<T>(std::uniform_real_distribution<double>(-1000.0, 1000.0)(random));
+		}
+		else {
+			value = static_cast<T>(std::uniform_int_distribution<int64_t>(std::numeric_limits<T>::min(), std::numeric_limits<T>::max())(random));
+		}
+	}
+	std::span<const char> buffer{ reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T) };
+	TwinCatLayout layout{ { TwinCatLayoutNode{ "", 0, sizeof(T), static_cast<ULONG>(dataType), 0, 1, 0, 1 } }, { TwinCatLayoutDim{ 0, count, sizeof(T) } } };
+	size_t bytes{};
+	double streams = measure([&] { return formatWithStreams<T>(buffer, count); }, bytes);
+	double perElement = measure([&] { return formatPerElement(layout, buffer, count); }, bytes);
+	double batched = measure([&] { return getVariableJSONValue(layout, 0, buffer, 0).second; }, bytes);
+	std::cout << name << " x " << count << " (" << bytes / 1024 << " KB JSON): "
+		<< "streams " << streams << " ms, per element " << perElement << " ms, batched " << batched << " ms, "
+		<< "speedup " << streams / batched << "x" << '\n';
+}
+
+int main(int argc, const char** argv)
+{
+	ULONG count = argc > 1 ? static_cast<ULONG>(std::stoul(argv[1])) : 100000;
+	benchmark<float>("ARRAY OF REAL", ADST_REAL32, count);
+	benchmark<double>("ARRAY OF LREAL", ADST_REAL64, count);
+	benchmark<INT16>("ARRAY OF INT", ADST_INT16, count);
+	benchmark<INT32>("ARRAY OF DINT", ADST_INT32, count);
+	return 0;
+}
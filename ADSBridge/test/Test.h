@@ -0,0 +1,64 @@
+// Test.h : Minimal test registry and check macros of the ADSBridge tests.
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+struct TestCase {
+	const char* name;
+	void (*run)();
+};
+
+inline std::vector<TestCase>& getTestCases() {
+	static std::vector<TestCase> testCases{};
+	return testCases;
+}
+
+// Number of failed checks of the running test
+inline int& getTestFailures() {
+	static int failures = 0;
+	return failures;
+}
+
+struct TestRegistration {
+	TestRegistration(const char* name, void (*run)()) {
+		getTestCases().push_back(TestCase{ name, run });
+	}
+};
+
+// Waits until predicate is true or timeout expired, returns last result of predicate
+inline bool waitFor(auto&& predicate, std::chrono::milliseconds timeout = std::chrono::milliseconds(2000)) {
+	auto until = std::chrono::steady_clock::now() + timeout;
+	while (!predicate()) {
+		if (std::chrono::steady_clock::now() > until) return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static TestRegistration name##Registration{ #name, name }; \
+	static void name()
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			getTestFailures()++; \
+			std::cerr << __FILE__ << ':' << __LINE__ << ": CHECK(" << #condition << ") failed" << '\n'; \
+		} \
+	} while (0)
+
+#define CHECK_EQUAL(actual, expected) \
+	do { \
+		auto&& actualValue = (actual); \
+		auto&& expectedValue = (expected); \
+		if (!(actualValue == expectedValue)) { \
+			getTestFailures()++; \
+			std::cerr << __FILE__ << ':' << __LINE__ << ": CHECK_EQUAL(" << #actual << ", " << #expected << ") failed: " \
+				<< actualValue << " != " << expectedValue << '\n'; \
+		} \
+	} while (0)
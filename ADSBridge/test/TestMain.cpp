@@ -0,0 +1,18 @@
+// TestMain.cpp : Runs all registered tests, or only those whose name contains the first argument.
+//
+#include <cstring>
+#include "Test.h"
+
+int main(int argc, const char** argv)
+{
+	int failed = 0;
+	for (const TestCase& testCase : getTestCases()) {
+		if (argc > 1 && !strstr(testCase.name, argv[1])) continue;
+		getTestFailures() = 0;
+		testCase.run();
+		std::cout << (getTestFailures() ? "FAILED " : "passed ") << testCase.name << '\n';
+		if (getTestFailures()) failed++;
+	}
+	std::cout << failed << " of " << getTestCases().size() << " tests failed" << '\n';
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,69 @@
+// TestPlc.h : Emulated PLC program with the AMS/TCP backend connected to it.
+
+#pragma once
+
+#include "../TwinCat.h"
+#include "AdsTestServer.h"
+
+struct TestPlc {
+	AdsTestServer server{};
+	AmsAddr addr{};
+	PAmsAddr pAddr = &addr;
+
+	// Declares program with primitives, strings, arrays and structs:
+	// MAIN.nCounter : DINT, MAIN.fValue : LREAL, MAIN.bFlag : BOOL, MAIN.sText : STRING(20),
+	// MAIN.aValues : ARRAY [1..4] OF INT, MAIN.aMatrix : ARRAY [0..1, 0..2] OF DINT,
+	// MAIN.stPoint : ST_Point (nX : INT, nY : INT, fZ : REAL), MAIN.aPoints : ARRAY [0..2] OF ST_Point,
+	// MAIN.stLine : ST_Line (stStart : ST_Point, stEnd : ST_Point, nId : DINT), MAIN.aSamples : ARRAY [0..2] OF LREAL
+	TestPlc() {
+		using Datatype = AdsTestServer::Datatype;
+		server.addDatatype(Datatype{ "INT", "", 2, ADST_INT16 });
+		server.addDatatype(Datatype{ "DINT", "", 4, ADST_INT32 });
+		server.addDatatype(Datatype{ "REAL", "", 4, ADST_REAL32 });
+		server.addDatatype(Datatype{ "LREAL", "", 8, ADST_REAL64 });
+		server.addDatatype(Datatype{ "BOOL", "", 1, ADST_BIT });
+		server.addDatatype(Datatype{ "STRING(20)", "", 21, ADST_STRING });
+		server.addDatatype(Datatype{ "ARRAY [1..4] OF INT", "INT", 8, ADST_INT16, { { 1, 4 } } });
+		server.addDatatype(Datatype{ "ARRAY [0..1, 0..2] OF DINT", "DINT", 24, ADST_INT32, { { 0, 2 }, { 0, 3 } } });
+		server.addDatatype(Datatype{ "ARRAY [0..2] OF LREAL", "LREAL", 24, ADST_REAL64, { { 0, 3 } } });
+		server.addDatatype(Datatype{ "ST_Point", "", 8, ADST_BIGTYPE, {}, {
+			Datatype{ "nX", "INT", 2, ADST_INT16, {}, {}, 0 },
+			Datatype{ "nY", "INT", 2, ADST_INT16, {}, {}, 2 },
+			Datatype{ "fZ", "REAL", 4, ADST_REAL32, {}, {}, 4 } } });
+		server.addDatatype(Datatype{ "ARRAY [0..2] OF ST_Point", "ST_Point", 24, ADST_BIGTYPE, { { 0, 3 } } });
+		server.addDatatype(Datatype{ "ST_Line", "", 20, ADST_BIGTYPE, {}, {
+			Datatype{ "stStart", "ST_Point", 8, ADST_BIGTYPE, {}, {}, 0 },
+			Datatype{ "stEnd", "ST_Point", 8, ADST_BIGTYPE, {}, {}, 8 },
+			Datatype{ "nId", "DINT", 4, ADST_INT32, {}, {}, 16 } } });
+		server.addSymbol("MAIN.nCounter", "DINT", 4, ADST_INT32, "Cycle counter");
+		server.addSymbol("MAIN.fValue", "LREAL", 8, ADST_REAL64);
+		server.addSymbol("MAIN.bFlag", "BOOL", 1, ADST_BIT);
+		server.addSymbol("MAIN.sText", "STRING(20)", 21, ADST_STRING);
+		server.addSymbol("MAIN.aValues", "ARRAY [1..4] OF INT", 8, ADST_INT16);
+		server.addSymbol("MAIN.aMatrix", "ARRAY [0..1, 0..2] OF DINT", 24, ADST_INT32);
+		server.addSymbol("MAIN.stPoint", "ST_Point", 8, ADST_BIGTYPE);
+		server.addSymbol("MAIN.aPoints", "ARRAY [0..2] OF ST_Point", 24, ADST_BIGTYPE);
+		server.addSymbol("MAIN.stLine", "ST_Line", 20, ADST_BIGTYPE);
+		server.addSymbol("MAIN.aSamples", "ARRAY [0..2] OF LREAL", 24, ADST_REAL64);
+		AmsNetId netId{ { 127, 0, 0, 1, 1, 1 } };
+		AmsTcpSetRouter("127.0.0.1", server.port(), &netId);
+		AdsPortOpen();
+		AdsGetLocalAddress(pAddr);
+		addr.port = 851;
+	}
+
+	~TestPlc() {
+		AdsPortClose();
+	}
+
+	// Uploads symbol and datatype tables like the bridge's update thread does
+	std::shared_ptr<const TwinCatSnapshot> load(uint64_t version = 1) {
+		auto [infoErr, uploadInfo] = getUploadInfo(pAddr);
+		auto [datatypeErr, datatypes] = getDatatypeMap(pAddr, uploadInfo);
+		auto [symbolErr, symbols] = getSymbolTable(pAddr, uploadInfo);
+		if (infoErr || datatypeErr || symbolErr) return nullptr;
+		auto layouts = getLayoutMap(datatypes, symbols);
+		auto index = getSymbolIndex(symbols);
+		return std::make_shared<const TwinCatSnapshot>(TwinCatSnapshot{ std::move(symbols), std::move(datatypes), std::move(layouts), std::move(index), version });
+	}
+};
@@ -0,0 +1,667 @@
+// TwinCatTest.cpp : Tests of symbol upload, value encoding/decoding (text and documents), sum commands, handles, notifications, member paths, field projection and array slicing.
+//
+#include <array>
+#include "Test.h"
+#include "TestPlc.h"
+
+TEST_CASE(uploadsSymbolsAndDatatypes) {
+	TestPlc plc{};
+	auto snapshot = plc.load();
+	CHECK(snapshot != nullptr);
+	CHECK_EQUAL(snapshot->symbols.size(), 10u);
+	const TwinCatVar* variable = snapshot->findSymbol("MAIN.nCounter");
+	CHECK(variable != nullptr);
+	CHECK_EQUAL(variable->type, "DINT");
+	CHECK_EQUAL(variable->comment, "Cycle counter");
+	CHECK_EQUAL(variable->indexGroup, AdsTestServer::PLC_MEMORY);
+	CHECK(snapshot->findSymbol("MAIN.nUnknown") == nullptr);
+	const TwinCatLayout& layout = snapshot->findLayout(*snapshot->findSymbol("MAIN.aPoints"));
+	CHECK_EQUAL(layout.nodes.size(), 4u);
+	CHECK_EQUAL(layout.getDims(0).size(), 1u);
+	CHECK_EQUAL(layout.getDims(0)[0].stride, 8u);
+}
+
+TEST_CASE(decodesValues) {
+	TestPlc plc{};
+	auto snapshot = plc.load();
+	plc.server.setValue("MAIN.nCounter", ADS_INT32{ -42 });
+	plc.server.setValue("MAIN.fValue", 1.5);
+	plc.server.setValue("MAIN.bFlag", UCHAR{ 1 });
+	plc.server.setValue("MAIN.sText", "a\"b", 4);
+	plc.server.setValue("MAIN.aValues", std::array<ADS_INT16, 4>{ 1, -2, 3, -4 });
+	plc.server.setValue("MAIN.aMatrix", std::array<ADS_INT32, 6>{ 1, 2, 3, 4, 5, 6 });
+	char point[8]{};
+	ADS_INT16 coordinates[2]{ 3, -4 };
+	float z = 0.5f;
+	memcpy(point, coordinates, sizeof(coordinates));
+	memcpy(point + 4, &z, sizeof(z));
+	plc.server.setValue("MAIN.stPoint", point, sizeof(point));
+	auto json = [&](const std::string& name) {
+		auto [nErr, value] = getVariableJSONValue(plc.pAddr, *snapshot, *snapshot->findSymbol(name));
+		CHECK_EQUAL(nErr, 0);
+		return value;
+	};
+	CHECK_EQUAL(json("MAIN.nCounter"), "-42");
+	CHECK_EQUAL(json("MAIN.fValue"), "1.5");
+	CHECK_EQUAL(json("MAIN.bFlag"), "true");
+	CHECK_EQUAL(json("MAIN.sText"), "\"a\\\"b\"");
+	CHECK_EQUAL(json("MAIN.aValues"), "[1,-2,3,-4]");
+	CHECK_EQUAL(json("MAIN.aMatrix"), "[[1,2,3],[4,5,6]]");
+	CHECK_EQUAL(nlohmann::json::parse(json("MAIN.stPoint")), nlohmann::json::parse("{\"nX\":3,\"nY\":-4,\"fZ\":0.5}"));
+}
+
+TEST_CASE(encodesValues) {
+	TestPlc plc{};
+	auto snapshot = plc.load();
+	auto write = [&](const std::string& name, const char* json) {
+		return setVariableJSONValue(plc.pAddr, *snapshot, *snapshot->findSymbol(name), nlohmann::json::parse(json));
+	};
+	CHECK_EQUAL(write("MAIN.nCounter", "123"), 0);
+	CHECK_EQUAL(plc.server.getValue<ADS_INT32>("MAIN.nCounter"), 123);
+	CHECK_EQUAL(write("MAIN.aMatrix", "[[1,2,3],[4,5,6]]"), 0);
+	CHECK((plc.server.getValue<std::array<ADS_INT32, 6>>("MAIN.aMatrix") == std::array<ADS_INT32, 6>{ 1, 2, 3, 4, 5, 6 }));
+	CHECK_EQUAL(write("MAIN.aPoints", "[{\"nX\":1,\"nY\":2,\"fZ\":3},{\"nX\":4,\"nY\":5,\"fZ\":6},{\"nX\":7,\"nY\":8,\"fZ\":9.5}]"), 0);
+	auto [nErr, value] = getVariableJSONValue(plc.pAddr, *snapshot, *snapshot->findSymbol("MAIN.aPoints"));
+	CHECK_EQUAL(nlohmann::json::parse(value)[2]["fZ"].get<double>(), 9.5);
+	CHECK_EQUAL(write("MAIN.sText", "\"hello\""), 0);
+	CHECK_EQUAL(std::string(plc.server.getValue("MAIN.sText").data()), "hello");
+	CHECK_EQUAL(write("MAIN.aValues", "[1,2,3]"), ADSERR_DEVICE_INVALIDDATA);
+	CHECK_EQUAL(write("MAIN.stPoint", "{\"nX\":1}"), ADSERR_DEVICE_INVALIDDATA);
+}
+
+TEST_CASE(readsAndWritesWithSumCommands) {
+	TestPlc plc{};
+	auto snapshot = plc.load();
+	plc.server.setValue("MAIN.nCounter", ADS_INT32{ 9 });
+	plc.server.setValue("MAIN.fValue", 2.25);
+	std::vector<const TwinCatVar*> variables{ snapshot->findSymbol("MAIN.nCounter"), snapshot->findSymbol("MAIN.fValue") };
+	auto ranges = getVariableRanges(variables);
+	ranges.push_back(TwinCatRange{ 0x1234, 0, 4 });
+	auto buffers = readVariableBuffers(plc.pAddr, ranges);
+	CHECK_EQUAL(plc.server.indexGroupCount(ADSIGRP_SUMUP_READ), 1u);
+	CHECK_EQUAL(buffers.size(), 3u);
+	CHECK_EQUAL(buffers[0].first, 0);
+	CHECK_EQUAL(getVariableJSONValue(*snapshot, *variables[1], buffers[1].second).second, "2.25");
+	CHECK_EQUAL(buffers[2].first, ADSERR_DEVICE_INVALIDGRP);
+	ADS_INT32 counter = 10;
+	double value = 4.5;
+	auto errors = writeVariableBuffers(plc.pAddr, ranges, { std::vector<char>((char*)&counter, (char*)&counter + 4), std::vector<char>((char*)&value, (char*)&value + 8), std::vector<char>(4) });
+	CHECK_EQUAL(plc.server.indexGroupCount(ADSIGRP_SUMUP_WRITE), 1u);
+	CHECK_EQUAL(errors[0], 0);
+	CHECK_EQUAL(errors[2], ADSERR_DEVICE_INVALIDGRP);
+	CHECK_EQUAL(plc.server.getValue<ADS_INT32>("MAIN.nCounter"), 10);
+	CHECK_EQUAL(plc.server.getValue<double>("MAIN.fValue"), 4.5);
+	// Requests with more sub commands than the PLC accepts are split
+	std::vector<TwinCatRange> many(MAX_SUM_COMMANDS + 1, TwinCatRange{ AdsTestServer::PLC_MEMORY, 0, 4 });
+	buffers = readVariableBuffers(plc.pAddr, many);
+	CHECK_EQUAL(buffers.size(), MAX_SUM_COMMANDS + 1);
+	CHECK_EQUAL(buffers.back().second.size(), 4u);
+	CHECK_EQUAL(plc.server.indexGroupCount(ADSIGRP_SUMUP_READ), 3u);
+}
+
+TEST_CASE(cachesAndRenewsHandles) {
+	TestPlc plc{};
+	auto snapshot = plc.load();
+	plc.server.setValue("MAIN.nCounter", ADS_INT32{ 3 });
+	TwinCatHandleCache handles{};
+	auto [nErr, value] = getVariableJSONValue(plc.pAddr, *snapshot, *snapshot->findSymbol("MAIN.nCounter"), &handles);
+	CHECK_EQUAL(nErr, 0);
+	CHECK_EQUAL(value, "3");
+	getVariableJSONValue(plc.pAddr, *snapshot, *snapshot->findSymbol("MAIN.nCounter"), &handles);
+	CHECK_EQUAL(plc.server.indexGroupCount(ADSIGRP_SUMUP_READWRITE), 1u);
+	CHECK_EQUAL(plc.server.handleCount(), 1u);
+	// Online change invalidates handle, which is acquired again once
+	plc.server.clearSymbols();
+	plc.server.addSymbol("MAIN.nCounter", "DINT", 4, ADST_INT32);
+	plc.server.setValue("MAIN.nCounter", ADS_INT32{ 4 });
+	auto [renewErr, renewed] = getVariableJSONValue(plc.pAddr, *snapshot, *snapshot->findSymbol("MAIN.nCounter"), &handles);
+	CHECK_EQUAL(renewErr, 0);
+	CHECK_EQUAL(renewed, "4");
+	CHECK_EQUAL(plc.server.indexGroupCount(ADSIGRP_SUMUP_READWRITE), 2u);
+	handles.release(plc.pAddr);
+	CHECK_EQUAL(plc.server.handleCount(), 0u);
+}
+
+TEST_CASE(cachesNotifiedValues) {
+	TestPlc plc{};
+	auto snapshot = plc.load();
+	plc.server.setValue("MAIN.nCounter", ADS_INT32{ 11 });
+	TwinCatNotificationCache notifications{};
+	CHECK_EQUAL(notifications.subscribe(plc.pAddr, *snapshot->findSymbol("MAIN.nCounter"), ADSTRANS_SERVERONCHA, 0, 0, std::chrono::milliseconds(0)), 0);
+	auto cached = [&](ADS_INT32 expected) {
+		auto value = notifications.get("MAIN.nCounter");
+		ADS_INT32 counter{};
+		if (value) memcpy(&counter, value->first.data(), sizeof(counter));
+		return value && counter == expected;
+	};
+	CHECK(waitFor([&]() { return cached(11); }));
+	plc.server.setValue("MAIN.nCounter", ADS_INT32{ 12 });
+	CHECK(waitFor([&]() { return cached(12); }));
+	// Subscribing again keeps the notification unless its transmission settings change
+	const TwinCatVar& counter = *snapshot->findSymbol("MAIN.nCounter");
+	size_t added = plc.server.requestCount(0x6);
+	CHECK_EQUAL(notifications.subscribe(plc.pAddr, counter, ADSTRANS_SERVERONCHA, 0, 0, std::chrono::milliseconds(5000)), 0);
+	CHECK_EQUAL(plc.server.requestCount(0x6), added);
+	CHECK_EQUAL(notifications.subscribe(plc.pAddr, counter, ADSTRANS_SERVERCYCLE, 10, 0, std::chrono::milliseconds(5000)), 0);
+	CHECK_EQUAL(plc.server.requestCount(0x6), added + 1);
+	CHECK_EQUAL(plc.server.requestCount(0x7), 1u);
+	CHECK_EQUAL(plc.server.notificationCount(), 1u);
+	CHECK(waitFor([&]() { return cached(12); }));
+	CHECK_EQUAL(notifications.unsubscribe(plc.pAddr, "MAIN.nCounter"), 0);
+	CHECK(!notifications.get("MAIN.nCounter"));
+	CHECK_EQUAL(plc.server.notificationCount(), 0u);
+}
+
+TEST_CASE(coalescesConcurrentReads) {
+	TestPlc plc{};
+	auto snapshot = plc.load();
+	plc.server.setValue("MAIN.nCounter", ADS_INT32{ 21 });
+	plc.server.setLatency(std::chrono::milliseconds(100));
+	TwinCatReadGroup reads{};
+	std::vector<std::shared_ptr<const TwinCatReadResult>> results(20);
+	std::vector<std::thread> threads{};
+	for (size_t i = 0; i < results.size(); i++) {
+		threads.emplace_back([&, i]() { results[i] = reads.read(plc.pAddr, *snapshot, *snapshot->findSymbol("MAIN.nCounter")); });
+	}
+	for (std::thread& thread : threads) thread.join();
+	CHECK_EQUAL(plc.server.indexGroupCount(AdsTestServer::PLC_MEMORY), 1u);
+	for (const auto& result : results) {
+		CHECK(result == results[0]);
+	}
+	CHECK_EQUAL(results[0]->nErr, 0);
+	CHECK_EQUAL(results[0]->value, "21");
+	// Reads after completion and reads of another snapshot version are not shared
+	plc.server.setLatency(std::chrono::milliseconds(0));
+	CHECK(reads.read(plc.pAddr, *snapshot, *snapshot->findSymbol("MAIN.nCounter")) != results[0]);
+	auto next = plc.load(2);
+	reads.read(plc.pAddr, *next, *next->findSymbol("MAIN.nCounter"));
+	CHECK_EQUAL(plc.server.indexGroupCount(AdsTestServer::PLC_MEMORY), 3u);
+}
+
+TEST_CASE(mergesAdjacentRanges) {
+	std::vector<TwinCatRange> ranges{
+		{ 0x4040, 100, 4 },
+		{ 0x4040, 0, 8 },
+		{ 0x4020, 8, 2 },
+		{ 0x4040, 8, 4 },
+		{ 0x4040, 2, 2 },
+		{ 0x4040, 40, 4 },
+	};
+	auto merged = getMergedRanges(ranges, 32);
+	CHECK_EQUAL(merged.size(), 3u);
+	CHECK_EQUAL(merged[0].range.indexGroup, 0x4020u);
+	CHECK_EQUAL(merged[1].range.indexOffset, 0u);
+	CHECK_EQUAL(merged[1].range.size, 44u);
+	CHECK_EQUAL(merged[1].parts.size(), 4u);
+	CHECK_EQUAL(merged[1].parts[1].first, 4u);
+	CHECK_EQUAL(merged[1].parts[1].second, 2u);
+	CHECK_EQUAL(merged[2].range.indexOffset, 100u);
+	CHECK_EQUAL(getMergedRanges(ranges, 0).size(), 4u);
+}
+
+TEST_CASE(readsMergedRanges) {
+	TestPlc plc{};
+	auto snapshot = plc.load();
+	plc.server.setValue("MAIN.nCounter", ADS_INT32{ 5 });
+	plc.server.setValue("MAIN.fValue", 6.5);
+	plc.server.setValue("MAIN.aValues", std::array<ADS_INT16, 4>{ 1, 2, 3, 4 });
+	std::vector<const TwinCatVar*> variables{ snapshot->findSymbol("MAIN.aValues"), snapshot->findSymbol("MAIN.nCounter"), snapshot->findSymbol("MAIN.fValue") };
+	auto ranges = getVariableRanges(variables);
+	auto buffers = readMergedBuffers(plc.pAddr, ranges);
+	CHECK_EQUAL(plc.server.indexGroupCount(ADSIGRP_SUMUP_READ), 1u);
+	CHECK_EQUAL(getVariableJSONValue(*snapshot, *variables[0], buffers[0].second).second, "[1,2,3,4]");
+	CHECK_EQUAL(getVariableJSONValue(*snapshot, *variables[1], buffers[1].second).second, "5");
+	CHECK_EQUAL(getVariableJSONValue(*snapshot, *variables[2], buffers[2].second).second, "6.5");
+	// A failing merged read is repeated for each of its ranges
+	ranges.push_back(TwinCatRange{ AdsTestServer::PLC_MEMORY, 0xFFFC, 8 });
+	ranges.push_back(TwinCatRange{ AdsTestServer::PLC_MEMORY, 0xFFF8, 4 });
+	buffers = readMergedBuffers(plc.pAddr, ranges);
+	CHECK_EQUAL(plc.server.indexGroupCount(ADSIGRP_SUMUP_READ), 3u);
+	CHECK_EQUAL(buffers[1].first, 0);
+	CHECK_EQUAL(buffers[3].first, ADSERR_DEVICE_INVALIDSIZE);
+	CHECK_EQUAL(buffers[4].first, 0);
+	CHECK_EQUAL(buffers[4].second.size(), 4u);
+}
+
+TEST_CASE(readsProjectedFields) {
+	TestPlc plc{};
+	auto snapshot = plc.load();
+	char line[20]{};
+	ADS_INT16 coordinates[4]{ 1, 2, 0, 0 };
+	ADS_INT32 id = 7;
+	float z = 2.5f;
+	memcpy(line, coordinates, 4);
+	memcpy(line + 8, coordinates + 2, 4);
+	memcpy(line + 12, &z, sizeof(z));
+	memcpy(line + 16, &id, sizeof(id));
+	plc.server.setValue("MAIN.stLine", line, sizeof(line));
+	const TwinCatVar& variable = *snapshot->findSymbol("MAIN.stLine");
+	const TwinCatLayout& layout = snapshot->findLayout(variable);
+	CHECK(!getLayoutFields(layout, { "stStart.nW" }));
+	CHECK(!getLayoutFields(layout, { "nId.nX" }));
+	CHECK(!getLayoutFields(layout, { "" }));
+	auto field = findLayoutField(layout, "stEnd.fZ");
+	CHECK(field.has_value());
+	CHECK_EQUAL(field->offset, 12u);
+	CHECK_EQUAL(field->size, 4u);
+	// Members nested in another requested member are dropped
+	auto fields = getLayoutFields(layout, { "stEnd.fZ", "nId", "stStart.nY", "stStart", "stEnd.nX" });
+	CHECK(fields.has_value());
+	CHECK_EQUAL(fields->size(), 4u);
+	auto [nErr, value] = getFieldsJSONValue(plc.pAddr, *snapshot, variable, *fields);
+	CHECK_EQUAL(nErr, 0);
+	CHECK_EQUAL(value, "{\"nId\":7,\"stEnd\":{\"fZ\":2.5,\"nX\":0},\"stStart\":{\"fZ\":0,\"nX\":1,\"nY\":2}}");
+	CHECK_EQUAL(plc.server.indexGroupCount(ADSIGRP_SUMUP_READ), 1u);
+	// Members far apart are read separately and decoded from a cached buffer the same way
+	fields = getLayoutFields(layout, { "stStart.nX", "nId" });
+	auto [readErr, read] = getFieldsJSONValue(plc.pAddr, *snapshot, variable, *fields, 0);
+	CHECK_EQUAL(readErr, 0);
+	CHECK_EQUAL(read, "{\"nId\":7,\"stStart\":{\"nX\":1}}");
+	CHECK_EQUAL(getFieldsJSONValue(*snapshot, variable, *fields, std::span<const char>(line, sizeof(line))).second, read);
+	CHECK_EQUAL(getFieldsJSONValue(*snapshot, variable, *fields, std::span<const char>(line, 8)).first, ADSERR_DEVICE_INVALIDSIZE);
+}
+
+TEST_CASE(readsAndWritesArraySlices) {
+	TestPlc plc{};
+	auto snapshot = plc.load();
+	plc.server.setValue("MAIN.aValues", std::array<ADS_INT16, 4>{ 1, 2, 3, 4 });
+	plc.server.setValue("MAIN.aMatrix", std::array<ADS_INT32, 6>{ 1, 2, 3, 4, 5, 6 });
+	const TwinCatVar& values = *snapshot->findSymbol("MAIN.aValues");
+	const TwinCatVar& matrix = *snapshot->findSymbol("MAIN.aMatrix");
+	auto slice = [&](const TwinCatVar& variable, const std::string& range) {
+		return getLayoutSlice(snapshot->findLayout(variable), 0, range);
+	};
+	CHECK(!slice(values, "0:2"));
+	CHECK(!slice(values, "3:2"));
+	CHECK(!slice(values, "1:x"));
+	CHECK(!slice(values, "1,1"));
+	CHECK(!slice(*snapshot->findSymbol("MAIN.nCounter"), "0"));
+	// Bounds are the declared indices, ARRAY [1..4] OF INT
+	size_t reads = plc.server.requestCount(2);
+	auto tail = slice(values, "3:");
+	CHECK(tail.has_value());
+	CHECK_EQUAL(tail->offset, 4u);
+	CHECK_EQUAL(tail->size, 4u);
+	CHECK_EQUAL(getSliceJSONValue(plc.pAddr, *snapshot, values, *tail).second, "[3,4]");
+	CHECK_EQUAL(plc.server.requestCount(2), reads + 1);
+	// Partial rows of a matrix are read with one request covering the first to last selected element
+	auto columns = slice(matrix, "0:1,1:2");
+	CHECK(columns.has_value());
+	CHECK(!columns->contiguous);
+	CHECK_EQUAL(columns->size, 20u);
+	CHECK_EQUAL(getSliceJSONValue(plc.pAddr, *snapshot, matrix, *columns).second, "[[2,3],[5,6]]");
+	CHECK_EQUAL(plc.server.requestCount(2), reads + 2);
+	CHECK_EQUAL(setSliceJSONValue(plc.pAddr, *snapshot, matrix, *columns, nlohmann::json::parse("[[0,0],[0,0]]")), ADSERR_DEVICE_INVALIDPARM);
+	auto row = slice(matrix, "1,1:2");
+	CHECK(row->contiguous);
+	CHECK_EQUAL(setSliceJSONValue(plc.pAddr, *snapshot, matrix, *row, nlohmann::json::parse("[[7]]")), ADSERR_DEVICE_INVALIDDATA);
+	CHECK_EQUAL(setSliceJSONValue(plc.pAddr, *snapshot, matrix, *row, nlohmann::json::parse("[[7,8]]")), 0);
+	CHECK_EQUAL(getVariableJSONValue(plc.pAddr, *snapshot, matrix).second, "[[1,2,3],[4,7,8]]");
+	std::vector<char> buffer = plc.server.getValue("MAIN.aMatrix");
+	CHECK_EQUAL(getSliceJSONValue(*snapshot, matrix, *columns, buffer).second, "[[2,3],[7,8]]");
+}
+
+TEST_CASE(resolvesMemberPaths) {
+	TestPlc plc{};
+	auto snapshot = plc.load();
+	plc.server.setValue("MAIN.aMatrix", std::array<ADS_INT32, 6>{ 1, 2, 3, 4, 5, 6 });
+	plc.server.setValue("MAIN.aPoints", std::array<ADS_INT16, 12>{ 0, 0, 0, 0, 5, -6, 0, 0, 0, 0, 0, 0 });
+	const TwinCatVar& line = *snapshot->findSymbol("MAIN.stLine");
+	auto member = findMember(*snapshot, "MAIN.stLine.stEnd.fZ");
+	CHECK(member.has_value());
+	CHECK_EQUAL(member->name, "MAIN.stLine.stEnd.fZ");
+	CHECK_EQUAL(member->indexGroup, line.indexGroup);
+	CHECK_EQUAL(member->indexOffset, line.indexOffset + 12);
+	CHECK_EQUAL(member->size, 4u);
+	CHECK_EQUAL(member->type, "REAL");
+	auto json = [&](const std::string& path) {
+		std::optional<TwinCatMember> resolved{};
+		const TwinCatVar* variable = findVariable(*snapshot, path, resolved);
+		CHECK(variable != nullptr);
+		return variable ? getVariableJSONValue(plc.pAddr, *snapshot, *variable).second : std::string{};
+	};
+	CHECK_EQUAL(json("MAIN.aMatrix[1,2]"), "6");
+	CHECK_EQUAL(json("MAIN.aMatrix[0,1]"), "2");
+	CHECK_EQUAL(json("MAIN.aPoints[1].nY"), "-6");
+	CHECK_EQUAL(nlohmann::json::parse(json("MAIN.aPoints[1]")), nlohmann::json::parse("{\"nX\":5,\"nY\":-6,\"fZ\":0}"));
+	// Indices are the declared bounds, ARRAY [1..4] OF INT
+	CHECK(findMember(*snapshot, "MAIN.aValues[4]").has_value());
+	CHECK(!findMember(*snapshot, "MAIN.aValues[0]"));
+	CHECK(!findMember(*snapshot, "MAIN.aValues[5]"));
+	CHECK(!findMember(*snapshot, "MAIN.aValues[x]"));
+	CHECK(!findMember(*snapshot, "MAIN.aMatrix[1]"));
+	CHECK(!findMember(*snapshot, "MAIN.aMatrix[1,2"));
+	CHECK(!findMember(*snapshot, "MAIN.stLine.nUnknown"));
+	CHECK(!findMember(*snapshot, "MAIN.stLine[0]"));
+	CHECK(!findMember(*snapshot, "MAIN.nCounter.nX"));
+	CHECK(!findMember(*snapshot, "MAIN.nUnknown.nX"));
+}
+
+TEST_CASE(decodesDocuments) {
+	TestPlc plc{};
+	auto snapshot = plc.load();
+	plc.server.setValue("MAIN.nCounter", ADS_INT32{ -42 });
+	plc.server.setValue("MAIN.fValue", 1.5);
+	plc.server.setValue("MAIN.bFlag", UCHAR{ 1 });
+	plc.server.setValue("MAIN.sText", "abc", 4);
+	plc.server.setValue("MAIN.aMatrix", std::array<ADS_INT32, 6>{ 1, 2, 3, 4, 5, 6 });
+	plc.server.setValue("MAIN.aPoints", std::array<ADS_INT16, 12>{ 1, 2, 0, 0, 3, 4, 0, 0, 5, 6, 0, 0 });
+	plc.server.setValue("MAIN.aSamples", std::array<double, 3>{ 0.5, std::nan(""), -INFINITY });
+	// Documents hold the same values as the JSON text of every symbol/variable
+	for (const TwinCatVar& variable : snapshot->symbols) {
+		auto [nErr, buffer] = readVariableBuffer(plc.pAddr, variable);
+		CHECK_EQUAL(nErr, 0);
+		auto [textErr, text] = getVariableJSONValue(*snapshot, variable, buffer);
+		auto [documentErr, document] = getVariableJSONDocument(*snapshot, variable, buffer);
+		CHECK_EQUAL(documentErr, textErr);
+		CHECK_EQUAL(document, nlohmann::json::parse(text));
+	}
+	auto [nErr, document] = getVariableJSONDocument(*snapshot, *snapshot->findSymbol("MAIN.aMatrix"), std::vector<char>(24));
+	CHECK_EQUAL(nlohmann::json::from_msgpack(nlohmann::json::to_msgpack(document)).dump(), "[[0,0,0],[0,0,0]]");
+	CHECK_EQUAL(getVariableJSONDocument(*snapshot, *snapshot->findSymbol("MAIN.aMatrix"), std::vector<char>(20)).first, ADSERR_DEVICE_INVALIDSIZE);
+}
+
+TEST_CASE(encodesNonFiniteNumbersAsNull) {
+	TestPlc plc{};
+	auto snapshot = plc.load();
+	plc.server.setValue("MAIN.fValue", std::nan(""));
+	plc.server.setValue("MAIN.aSamples", std::array<double, 3>{ 0.5, std::nan(""), -INFINITY });
+	plc.server.setValue("MAIN.stPoint", std::array<float, 2>{ 0.0f, INFINITY });
+	// JSON has no NaN or infinity, so whole values, batched arrays and struct members are null and the text stays valid
+	CHECK_EQUAL(getVariableJSONValue(plc.pAddr, *snapshot, *snapshot->findSymbol("MAIN.fValue")).second, "null");
+	CHECK_EQUAL(getVariableJSONValue(plc.pAddr, *snapshot, *snapshot->findSymbol("MAIN.aSamples")).second, "[0.5,null,null]");
+	auto [nErr, point] = getVariableJSONValue(plc.pAddr, *snapshot, *snapshot->findSymbol("MAIN.stPoint"));
+	CHECK_EQUAL(nlohmann::json::parse(point)["fZ"], nullptr);
+	// MessagePack bodies are converted from the JSON text
+	auto msgpack = nlohmann::json::to_msgpack(nlohmann::json::parse(getVariableJSONValue(plc.pAddr, *snapshot, *snapshot->findSymbol("MAIN.aSamples")).second));
+	CHECK_EQUAL(nlohmann::json::from_msgpack(msgpack).dump(), "[0.5,null,null]");
+	auto [bufferErr, buffer] = readVariableBuffer(plc.pAddr, *snapshot->findSymbol("MAIN.aSamples"));
+	CHECK_EQUAL(nlohmann::json::from_msgpack(nlohmann::json::to_msgpack(getVariableJSONDocument(*snapshot, *snapshot->findSymbol("MAIN.aSamples"), buffer).second)).dump(), "[0.5,null,null]");
+}
+
+TEST_CASE(describesLayouts) {
+	TestPlc plc{};
+	auto snapshot = plc.load();
+	TwinCatLayoutCache descriptors{};
+	auto descriptor = descriptors.get(*snapshot, *snapshot->findSymbol("MAIN.aPoints"));
+	auto json = nlohmann::json::parse(*descriptor);
+	CHECK_EQUAL(json["Type"], "ARRAY [0..2] OF ST_Point");
+	CHECK_EQUAL(json["Size"], 24);
+	CHECK_EQUAL(json["Nodes"].size(), 4u);
+	CHECK_EQUAL(json["Nodes"][0]["Dims"], nlohmann::json::parse("[{\"LowerBound\":0,\"Elements\":3,\"Stride\":8}]"));
+	CHECK_EQUAL(json["Nodes"][0]["End"], 4);
+	CHECK_EQUAL(json["Nodes"][1]["Name"], "fZ");
+	CHECK_EQUAL(json["Nodes"][1]["Offset"], 4);
+	CHECK_EQUAL(json["Nodes"][1]["DataType"], ADST_REAL32);
+	// Descriptors are built once per datatype and snapshot version
+	CHECK(descriptors.get(*snapshot, *snapshot->findSymbol("MAIN.aPoints")) == descriptor);
+	CHECK(descriptors.get(*plc.load(2), *snapshot->findSymbol("MAIN.aPoints")) != descriptor);
+	// Raw reads share the bytes without decoding them
+	plc.server.setValue("MAIN.nCounter", ADS_INT32{ 17 });
+	TwinCatReadGroup reads{};
+	auto result = reads.read(plc.pAddr, *snapshot, *snapshot->findSymbol("MAIN.nCounter"), nullptr, TwinCatDecoding::Raw);
+	CHECK_EQUAL(result->nErr, 0);
+	CHECK(result->value.empty());
+	CHECK_EQUAL(result->buffer.size(), 4u);
+	CHECK_EQUAL(*reinterpret_cast<const ADS_INT32*>(result->buffer.data()), 17);
+}
+
+TEST_CASE(streamsJSONText) {
+	TestPlc plc{};
+	auto snapshot = plc.load();
+	plc.server.setValue("MAIN.aMatrix", std::array<ADS_INT32, 6>{ 1, -2, 3, 4, 5, 6 });
+	const TwinCatVar& matrix = *snapshot->findSymbol("MAIN.aMatrix");
+	auto [nErr, buffer] = readVariableBuffer(plc.pAddr, matrix);
+	// Chunks are handed to the sink as soon as they are full, their concatenation is the complete text
+	std::vector<std::string> chunks{};
+	TwinCatJSONWriter writer{ [&chunks](const char* data, size_t size) { chunks.emplace_back(data, size); return true; }, 4 };
+	CHECK_EQUAL(writeVariableJSONValue(snapshot->findLayout(matrix), 0, buffer, 0, writer), 0);
+	CHECK(writer.flush());
+	CHECK(chunks.size() > 1);
+	CHECK_EQUAL(std::accumulate(chunks.begin(), chunks.end(), std::string{}), "[[1,-2,3],[4,5,6]]");
+	// A failing sink stops further output
+	size_t calls = 0;
+	TwinCatJSONWriter failing{ [&calls](const char*, size_t) { calls++; return false; }, 4 };
+	writeVariableJSONValue(snapshot->findLayout(matrix), 0, buffer, 0, failing);
+	CHECK(!failing.flush());
+	CHECK_EQUAL(calls, 1u);
+	// Floating point numbers are written in their shortest round trip form
+	std::string text{};
+	appendJSONNumber(text, 0.1f);
+	text.push_back(',');
+	appendJSONNumber(text, 123456789.0);
+	text.push_back(',');
+	appendJSONNumber(text, INT8{ -5 });
+	CHECK_EQUAL(text, "0.1,123456789,-5");
+}
+
+TEST_CASE(formatsPrimitiveArraysInBatches) {
+	// ARRAY [0..199] OF INT spans several batches
+	TwinCatLayout values{ { TwinCatLayoutNode{ "", 0, 2, ADST_INT16, 0, 1, 0, 1 } }, { TwinCatLayoutDim{ 0, 200, 2 } } };
+	std::vector<ADS_INT16> data(200);
+	std::string expected{ "[" };
+	for (ADS_INT16 i = 0; i < 200; i++) {
+		data[i] = static_cast<ADS_INT16>(i * 301 - 30000);
+		expected += (i > 0 ? "," : "") + std::to_string(data[i]);
+	}
+	expected += "]";
+	std::span<const char> buffer{ reinterpret_cast<const char*>(data.data()), data.size() * sizeof(ADS_INT16) };
+	CHECK_EQUAL(getVariableJSONValue(values, 0, buffer, 0).second, expected);
+	// Elements exceeding the buffer are decoded one by one, so only those are null
+	auto [nErr, value] = getVariableJSONValue(values, 0, buffer.subspan(0, 396), 0);
+	CHECK_EQUAL(nErr, ADSERR_DEVICE_INVALIDSIZE);
+	CHECK_EQUAL(value.substr(value.size() - 16), "29297,null,null]");
+	// BOOL elements are true for any byte but 0
+	TwinCatLayout flags{ { TwinCatLayoutNode{ "", 0, 1, ADST_BIT, 0, 1, 0, 1 } }, { TwinCatLayoutDim{ 0, 3, 1 } } };
+	const char bytes[]{ 0, 1, 2 };
+	CHECK_EQUAL(getVariableJSONValue(flags, 0, bytes, 0).second, "[false,true,true]");
+}
+
+#ifdef ADSBRIDGE_SSE2_SUPPORT
+TEST_CASE(formatsIntegersWithSSE2) {
+	// Vector digits match std::to_chars at the limits of every type, around powers of ten and for a spread of values
+	auto same = [](auto value) {
+		char expected[32];
+		char actual[32];
+		char* end = std::to_chars(expected, expected + sizeof(expected), +value).ptr;
+		return std::string_view(actual, formatIntegerSSE2(actual, +value)) == std::string_view(expected, end);
+	};
+	auto limits = [&](auto value) {
+		using T = decltype(value);
+		return same(std::numeric_limits<T>::min()) && same(std::numeric_limits<T>::max()) && same(T{ 0 }) && same(T{ 1 });
+	};
+	CHECK(limits(INT8{}) && limits(INT16{}) && limits(INT32{}) && limits(INT64{}));
+	CHECK(limits(UINT8{}) && limits(UINT16{}) && limits(UINT32{}) && limits(UINT64{}));
+	bool powers = true;
+	for (UINT64 power = 1; power <= 10000000000000000000ull; power *= 10) {
+		powers = powers && same(power - 1) && same(power) && same(power + 1);
+		powers = powers && (power > INT64_MAX || same(-static_cast<INT64>(power)));
+		if (power == 10000000000000000000ull) break;
+	}
+	CHECK(powers);
+	bool spread = true;
+	UINT64 value = 1;
+	for (int i = 0; i < 1000; i++, value = value * 3 + 7) {
+		spread = spread && same(value) && same(static_cast<INT64>(value)) && same(static_cast<UINT32>(value)) && same(static_cast<INT32>(value));
+	}
+	CHECK(spread);
+}
+#endif
+
+TEST_CASE(encodesBodiesWhileParsing) {
+	TestPlc plc{};
+	auto snapshot = plc.load();
+	// Encoded bytes match those encoded from a parsed document
+	auto matches = [&](const std::string& name, const std::string& json) {
+		const TwinCatVar& variable = *snapshot->findSymbol(name);
+		auto result = setVariableJSONBody(*snapshot, variable, "{\"Data\":" + json + "}");
+		auto [nErr, buffer] = setVariableJSONValue(*snapshot, variable, nlohmann::json::parse(json));
+		return result.valid && result.nErr == nErr && (nErr || result.buffer == buffer);
+	};
+	CHECK(matches("MAIN.aMatrix", "[[1,2,3],[4,-5,6]]"));
+	CHECK(matches("MAIN.aPoints", "[{\"nX\":1,\"nY\":2,\"fZ\":3},{\"fZ\":6.5,\"nY\":5,\"nX\":4},{\"nX\":7,\"nY\":8,\"fZ\":9,\"sExtra\":[{}]}]"));
+	CHECK(matches("MAIN.stLine", "{\"nId\":3,\"stStart\":{\"nX\":1,\"nY\":2,\"fZ\":0.5},\"stEnd\":{\"nX\":3,\"nY\":4,\"fZ\":1}}"));
+	CHECK(matches("MAIN.sText", "\"longer than twenty characters\""));
+	CHECK(matches("MAIN.bFlag", "true"));
+	CHECK(matches("MAIN.aValues", "[1,2,3]"));
+	CHECK(matches("MAIN.aValues", "[1,2,3,4,5]"));
+	CHECK(matches("MAIN.aMatrix", "[[1,2,3],[4,5]]"));
+	CHECK(matches("MAIN.stPoint", "{\"nX\":1,\"nX\":2,\"fZ\":0}"));
+	CHECK(matches("MAIN.aPoints", "[1,2,3]"));
+	CHECK(matches("MAIN.nCounter", "1.5"));
+	CHECK(matches("MAIN.bFlag", "1"));
+	const TwinCatVar& counter = *snapshot->findSymbol("MAIN.nCounter");
+	CHECK_EQUAL(setVariableJSONBody(*snapshot, counter, "{\"Value\":1}").nErr, ADSERR_DEVICE_INVALIDDATA);
+	CHECK(!setVariableJSONBody(*snapshot, counter, "{\"Data\":1").valid);
+	// Written with a single request, binary bodies are decoded the same way
+	CHECK_EQUAL(setVariableJSONBody(plc.pAddr, *snapshot, counter, "{\"Data\":-7,\"Timestamp\":1}").nErr, 0);
+	CHECK_EQUAL(plc.server.getValue<ADS_INT32>("MAIN.nCounter"), -7);
+	std::vector<std::uint8_t> msgpack = nlohmann::json::to_msgpack(nlohmann::json::parse("{\"Data\":{\"nX\":1,\"nY\":2,\"fZ\":0.25}}"));
+	const TwinCatVar& point = *snapshot->findSymbol("MAIN.stPoint");
+	CHECK_EQUAL(setVariableJSONBody(plc.pAddr, *snapshot, point, std::string(msgpack.begin(), msgpack.end()), nlohmann::json::input_format_t::msgpack).nErr, 0);
+	CHECK_EQUAL(nlohmann::json::parse(getVariableJSONValue(plc.pAddr, *snapshot, point).second), nlohmann::json::parse("{\"nX\":1,\"nY\":2,\"fZ\":0.25}"));
+}
+
+TEST_CASE(listsSymbolsInPages) {
+	TestPlc plc{};
+	auto snapshot = plc.load();
+	std::vector<std::string> names{};
+	std::string after{};
+	size_t pages = 0;
+	do {
+		auto page = nlohmann::json::parse(getSymbolPage(*snapshot, after, 4));
+		CHECK(page["Symbols"].size() <= 4);
+		for (const auto& [name, symbol] : page["Symbols"].items()) {
+			CHECK_EQUAL(symbol["Name"].get<std::string>(), name);
+			names.push_back(name);
+		}
+		after = page["Next"].is_null() ? std::string{} : page["Next"].get<std::string>();
+		pages++;
+	} while (!after.empty() && pages < 10);
+	// Every symbol/variable is listed once, in name order
+	CHECK_EQUAL(pages, 3u);
+	CHECK_EQUAL(names.size(), snapshot->symbols.size());
+	CHECK(std::is_sorted(names.begin(), names.end()));
+	CHECK(std::adjacent_find(names.begin(), names.end()) == names.end());
+	// Cursors need not name an existing symbol/variable
+	CHECK_EQUAL(getSymbolPage(*snapshot, "MAIN.zzz", 4), "{\"Symbols\":{},\"Next\":null}");
+	auto page = nlohmann::json::parse(getSymbolPage(*snapshot, "MAIN.b", 1));
+	CHECK_EQUAL(page["Next"].get<std::string>(), "MAIN.bFlag");
+	// Listing written in chunks matches the listing written at once
+	TwinCatJSONWriter whole{};
+	writeSymbolEntries(snapshot->symbols.begin(), snapshot->symbols.end(), snapshot->symbols.size(), whole);
+	std::string chunked{};
+	auto it = snapshot->symbols.begin();
+	while (it != snapshot->symbols.end()) {
+		TwinCatJSONWriter writer{};
+		bool first = it == snapshot->symbols.begin();
+		it = writeSymbolEntries(it, snapshot->symbols.end(), 2, writer, first);
+		chunked += writer.str();
+	}
+	CHECK_EQUAL(chunked, whole.str());
+}
+
+TEST_CASE(searchesSymbols) {
+	TestPlc plc{};
+	auto snapshot = plc.load();
+	auto names = [&](const TwinCatSymbolQuery& query, const std::string& after = "", size_t limit = 100) {
+		auto page = nlohmann::json::parse(findSymbols(*snapshot, query, after, limit));
+		std::string result{};
+		for (const auto& [name, symbol] : page["Symbols"].items()) {
+			result += (result.empty() ? "" : ",") + name;
+		}
+		if (!page["Next"].is_null()) result += ";" + page["Next"].get<std::string>();
+		return result;
+	};
+	CHECK(matchGlob("main.a*", "main.avalues"));
+	CHECK(matchGlob("*.?flag", "main.bflag"));
+	CHECK(matchGlob("a*b*c", "axxbyyc"));
+	CHECK(!matchGlob("a*b*c", "axxbyy"));
+	CHECK(matchGlob("*", ""));
+	// Names, type names and comments are matched case insensitive
+	CHECK_EQUAL(names({ .prefix = "main.st" }), "MAIN.sText,MAIN.stLine,MAIN.stPoint");
+	CHECK_EQUAL(names({ .match = "*.A*S" }), "MAIN.aPoints,MAIN.aSamples,MAIN.aValues");
+	CHECK_EQUAL(names({ .prefix = "MAIN.a", .match = "*matrix" }), "MAIN.aMatrix");
+	CHECK_EQUAL(names({ .prefix = "MAIN.b", .match = "MAIN.a*" }), "");
+	CHECK_EQUAL(names({ .type = "array *" }), "MAIN.aMatrix,MAIN.aPoints,MAIN.aSamples,MAIN.aValues");
+	CHECK_EQUAL(names({ .comment = "COUNTER" }), "MAIN.nCounter");
+	CHECK_EQUAL(names({ .prefix = "MAIN.", .type = "st_*" }), "MAIN.stLine,MAIN.stPoint");
+	// Pages continue after the last name of the previous page
+	CHECK_EQUAL(names({ .prefix = "main.a" }, "", 2), "MAIN.aMatrix,MAIN.aPoints;MAIN.aPoints");
+	CHECK_EQUAL(names({ .prefix = "main.a" }, "MAIN.aPoints", 2), "MAIN.aSamples,MAIN.aValues");
+	CHECK_EQUAL(names({ .prefix = "main.a" }, "main.apoints", 2), "MAIN.aSamples,MAIN.aValues");
+}
+
+TEST_CASE(indexesSymbolUpload) {
+	std::vector<char> data{};
+	auto addEntry = [&](const std::string& name, ULONG indexOffset, const std::string& type, const std::string& comment) {
+		AdsSymbolEntry entry{};
+		entry.entryLength = static_cast<ULONG>(sizeof(AdsSymbolEntry) + name.size() + type.size() + comment.size() + 3);
+		entry.iGroup = 0x4040;
+		entry.iOffs = indexOffset;
+		entry.size = 4;
+		entry.nameLength = static_cast<USHORT>(name.size());
+		entry.typeLength = static_cast<USHORT>(type.size());
+		entry.commentLength = static_cast<USHORT>(comment.size());
+		const char* bytes = reinterpret_cast<const char*>(&entry);
+		data.insert(data.end(), bytes, bytes + sizeof(entry));
+		for (const std::string* text : { &name, &type, &comment }) {
+			data.insert(data.end(), text->begin(), text->end());
+			data.push_back('\0');
+		}
+	};
+	addEntry("MAIN.nB", 4, "DINT", "Second");
+	addEntry("MAIN.nA", 0, "DINT", "");
+	addEntry("MAIN.nB", 8, "UDINT", "Redeclared");
+	addEntry("MAIN.nC", 12, "DINT", "Truncated");
+	// Last entry is cut off by the upload size
+	AdsSymbolUploadInfo2 info{};
+	info.nSymbols = 4;
+	info.nSymSize = static_cast<ULONG>(data.size() - 4);
+	std::shared_ptr<char[]> upload{ new char[data.size()] };
+	memcpy(upload.get(), data.data(), data.size());
+	TwinCatSymbolTable symbols = getSymbolTable(upload, info);
+	CHECK_EQUAL(symbols.size(), 2u);
+	CHECK_EQUAL(symbols.begin()->name, "MAIN.nA");
+	// Later declarations replace earlier ones
+	auto it = symbols.find("MAIN.nB");
+	CHECK(it != symbols.end());
+	CHECK_EQUAL(it->indexOffset, 8u);
+	CHECK_EQUAL(it->type, "UDINT");
+	CHECK_EQUAL(it->comment, "Redeclared");
+	CHECK(symbols.find("MAIN.nC") == symbols.end());
+	CHECK(symbols.find("MAIN.n") == symbols.end());
+	CHECK(symbols.upper_bound("MAIN.nA") == it);
+	// Declarations are views into the upload, which the table keeps alive
+	CHECK(it->name.data() >= upload.get() && it->name.data() < upload.get() + data.size());
+	upload.reset();
+	TwinCatSymbolTable copy = symbols;
+	symbols = TwinCatSymbolTable{};
+	CHECK_EQUAL(copy.find("MAIN.nB")->comment, "Redeclared");
+}
+
+TEST_CASE(looksUpSymbolsByHash) {
+	// Names differing in a single character land in the same probe sequences often enough to exercise collisions
+	std::vector<std::string> names{};
+	for (int i = 0; i < 5000; i++) {
+		names.push_back("GVL_Axis" + std::to_string(i % 50) + ".fb" + std::to_string(i));
+	}
+	std::vector<TwinCatVar> declarations{};
+	for (size_t i = 0; i < names.size(); i++) {
+		declarations.push_back(TwinCatVar{ names[i], 0x4040, static_cast<ULONG>(i), 4, "DINT", "" });
+	}
+	TwinCatSymbolTable symbols{ nullptr, declarations };
+	CHECK_EQUAL(symbols.size(), names.size());
+	bool found = true;
+	for (size_t i = 0; i < names.size(); i++) {
+		auto it = symbols.find(names[i]);
+		found = found && it != symbols.end() && it->indexOffset == i && it->name == names[i];
+	}
+	CHECK(found);
+	CHECK(symbols.find("GVL_Axis1.fb") == symbols.end());
+	CHECK(symbols.find("") == symbols.end());
+	TwinCatSymbolTable empty{};
+	CHECK(empty.find("GVL_Axis1.fb1") == empty.end());
+	// Lookups return the declaration stored in the table
+	CHECK_EQUAL(&*symbols.find(names[42]), &*symbols.lower_bound(names[42]));
+}